@@ -0,0 +1,78 @@
+#ifndef Benchmark_h
+#define Benchmark_h
+
+#include <stdio.h>
+#include "../XGI/XGI.h"
+
+// Shared by the benchmark programs, each one is its own program with a main function like Example/main.c.
+// They run headless and without validation so they can be timed on machines without a display, run them from the repository's root directory
+
+/// Initializes XGI without a window
+static inline void BenchmarkInitialize(void)
+{
+	WindowConfigure windowConfig =
+	{
+		.Width = 1280,
+		.Height = 720,
+		.Title = "XGI Benchmark",
+	};
+	GraphicsConfigure graphicsConfig =
+	{
+		.VulkanValidation = false,
+		.FrameResourceCount = 3,
+		.Headless = true,
+	};
+	XGIInitialize(windowConfig, graphicsConfig);
+}
+
+/// Gets the time from a high resolution clock
+/// \return The time in milliseconds
+static inline double BenchmarkTime(void)
+{
+	return (double)SDL_GetPerformanceCounter() * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+/// Creates a framebuffer the size of the benchmark's window
+/// \return The framebuffer object
+static inline FrameBuffer BenchmarkCreateFrameBuffer(void)
+{
+	FrameBufferConfigure config =
+	{
+		.Width = Window.Width,
+		.Height = Window.Height,
+		.Filter = TextureFilterNearest,
+		.AddressMode = TextureAddressModeClamp,
+	};
+	return FrameBufferCreate(config);
+}
+
+/// Creates a pipeline that draws Vector3 positions in a flat color, they're transformed by the push constant mat4 Transform
+/// \param vertexLayout The vertex layout, its first attribute must be a Vector3
+/// \return The pipeline object
+static inline Pipeline BenchmarkCreateFlatPipeline(VertexLayout vertexLayout)
+{
+	PipelineConfigure config =
+	{
+		.VertexLayout = vertexLayout,
+		.ShaderCount = 2,
+		.Shaders =
+		{
+			ShaderDataFromFile(ShaderTypeVertex, "Benchmarks/Shaders/Flat.vert", false),
+			ShaderDataFromFile(ShaderTypeFragment, "Benchmarks/Shaders/Flat.frag", false),
+		},
+		.Primitive = VertexPrimitiveTriangleList,
+		.LineWidth = 1.0,
+		.PolygonMode = PolygonModeFill,
+		.CullMode = CullModeNone,
+		.CullClockwise = true,
+		.AlphaBlend = false,
+		.DepthTest = false,
+		.StencilTest = false,
+	};
+	Pipeline pipeline = PipelineCreate(config);
+	ShaderDataDestroy(config.Shaders[0]);
+	ShaderDataDestroy(config.Shaders[1]);
+	return pipeline;
+}
+
+#endif
@@ -0,0 +1,197 @@
+#include "Benchmark.h"
+
+// Checks that a steady-state frame doesn't allocate from the heap.
+// malloc, calloc and realloc are replaced with versions that count the calls made while a frame is timed, then call glibc's.
+// The frame uses uniform buffers, samplers, push constants, a render queue, record jobs and a vertex buffer upload.
+// Allocations made by the vulkan driver are counted too. Exits with 1 if there were any allocations
+
+#define WarmupFrames 16
+#define CountedFrames 64
+#define DrawCount 256
+#define JobDrawCount 64
+
+#ifdef __GLIBC__
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t count, size_t size);
+extern void * __libc_realloc(void * pointer, size_t size);
+
+static SDL_atomic_t Counting;
+static SDL_atomic_t Allocations;
+
+void * malloc(size_t size)
+{
+	if (SDL_AtomicGet(&Counting)) { SDL_AtomicAdd(&Allocations, 1); }
+	return __libc_malloc(size);
+}
+
+void * calloc(size_t count, size_t size)
+{
+	if (SDL_AtomicGet(&Counting)) { SDL_AtomicAdd(&Allocations, 1); }
+	return __libc_calloc(count, size);
+}
+
+void * realloc(void * pointer, size_t size)
+{
+	if (SDL_AtomicGet(&Counting)) { SDL_AtomicAdd(&Allocations, 1); }
+	return __libc_realloc(pointer, size);
+}
+#endif
+
+typedef struct Vertex
+{
+	Vector3 Position;
+} Vertex;
+
+typedef struct TexturedVertex
+{
+	Vector3 Position;
+	Vector2 UV;
+} TexturedVertex;
+
+FrameBuffer frameBuffer;
+VertexLayout vertexLayout;
+Pipeline flatPipeline;
+Pipeline uniformPipeline;
+Pipeline texturePipeline;
+VertexLayout textureLayout;
+VertexBuffer vertexBuffer;
+VertexBuffer dynamicBuffer;
+UniformBuffer uniformBuffer;
+Texture texture;
+RenderQueue renderQueue;
+
+static Pipeline CreatePipeline(VertexLayout layout, const char * vertexShader, const char * fragmentShader)
+{
+	PipelineConfigure config =
+	{
+		.VertexLayout = layout,
+		.ShaderCount = 2,
+		.Shaders =
+		{
+			ShaderDataFromFile(ShaderTypeVertex, vertexShader, false),
+			ShaderDataFromFile(ShaderTypeFragment, fragmentShader, false),
+		},
+		.Primitive = VertexPrimitiveTriangleList,
+		.LineWidth = 1.0,
+		.PolygonMode = PolygonModeFill,
+		.CullMode = CullModeNone,
+		.CullClockwise = true,
+	};
+	Pipeline pipeline = PipelineCreate(config);
+	ShaderDataDestroy(config.Shaders[0]);
+	ShaderDataDestroy(config.Shaders[1]);
+	return pipeline;
+}
+
+static void RecordDraws(void * data)
+{
+	GraphicsBindPipeline(uniformPipeline);
+	for (int i = 0; i < JobDrawCount; i++) { GraphicsRenderVertexBuffer(vertexBuffer); }
+}
+
+static void RenderFrame(int frame)
+{
+	// Changed every frame so that the uniforms, descriptors and upload aren't skipped as redundant
+	Matrix4x4 transform = Matrix4x4FromTranslate((Vector3){ (frame % 16) / 16.0f, 0.0f, 0.0f });
+	UniformBufferSetVariable(uniformBuffer, "Transform", &transform);
+	PipelineSetUniform(uniformPipeline, 0, 0, uniformBuffer);
+	PipelineSetSampler(texturePipeline, 0, 0, texture);
+	TexturedVertex * vertices = VertexBufferMapVertices(dynamicBuffer);
+	for (int i = 0; i < 3; i++) { vertices[i] = (TexturedVertex){ { i * 0.1f, frame % 2 * 0.1f, 0.0f }, { i * 0.5f, 0.0f } }; }
+	VertexBufferUnmapVertices(dynamicBuffer);
+	VertexBufferUpload(dynamicBuffer);
+	
+	GraphicsAquireNextImage();
+	GraphicsBegin(frameBuffer);
+	GraphicsClearColor(ColorFromHex(0x000000ff));
+	for (int i = 0; i < DrawCount; i++)
+	{
+		Matrix4x4 drawTransform = Matrix4x4FromTranslate((Vector3){ 0.0f, i / (Scalar)DrawCount, 0.0f });
+		RenderPacket packet =
+		{
+			.Pipeline = i % 2 == 0 ? flatPipeline : uniformPipeline,
+			.Material = i % 4,
+			.Depth = (Scalar)i,
+			.VertexBuffer = vertexBuffer,
+			.PushConstants = i % 2 == 0 ? &drawTransform : NULL,
+		};
+		RenderQueueSubmit(renderQueue, packet);
+	}
+	RenderQueueFlush(renderQueue);
+	// A job for every worker thread and the calling thread, a thread's first record job sets up its thread local storage
+	GraphicsRecordJob jobs[64];
+	int jobCount = SDL_min(JobSystemGetThreadCount() + 1, 64);
+	for (int i = 0; i < jobCount; i++) { jobs[i] = (GraphicsRecordJob){ .Function = RecordDraws }; }
+	GraphicsRecordParallel(jobs, jobCount);
+	GraphicsBindPipeline(texturePipeline);
+	GraphicsRenderVertexBuffer(dynamicBuffer);
+	GraphicsEnd();
+	GraphicsPresent();
+}
+
+int main(int argc, char * argv[])
+{
+#ifndef __GLIBC__
+	printf("Counting allocations needs glibc to replace malloc\n");
+	return 0;
+#endif
+	BenchmarkInitialize();
+	
+	frameBuffer = BenchmarkCreateFrameBuffer();
+	VertexAttribute attributes[] = { VertexAttributeVector3 };
+	vertexLayout = VertexLayoutCreate(1, attributes);
+	VertexAttribute textureAttributes[] = { VertexAttributeVector3, VertexAttributeVector2 };
+	textureLayout = VertexLayoutCreate(2, textureAttributes);
+	flatPipeline = BenchmarkCreateFlatPipeline(vertexLayout);
+	uniformPipeline = CreatePipeline(vertexLayout, "Benchmarks/Shaders/Uniform.vert", "Benchmarks/Shaders/Flat.frag");
+	texturePipeline = CreatePipeline(textureLayout, "Example/Shaders/Default.vert", "Example/Shaders/Default.frag");
+	PipelineSetPushConstant(texturePipeline, "Transform", &Matrix4x4Identity);
+	uniformBuffer = UniformBufferCreate(uniformPipeline, 0);
+	
+	vertexBuffer = VertexBufferCreate(3, sizeof(Vertex));
+	Vertex * vertices = VertexBufferMapVertices(vertexBuffer);
+	vertices[0] = (Vertex){ { 0.0f, 0.0f, 0.0f } };
+	vertices[1] = (Vertex){ { 0.1f, 0.0f, 0.0f } };
+	vertices[2] = (Vertex){ { 0.0f, 0.1f, 0.0f } };
+	VertexBufferUnmapVertices(vertexBuffer);
+	VertexBufferUpload(vertexBuffer);
+	dynamicBuffer = VertexBufferCreate(3, sizeof(TexturedVertex));
+	
+	TextureData data = TextureDataFromFile("Example/texture.jpg");
+	TextureConfigure textureConfig =
+	{
+		.Format = TextureFormatColor,
+		.Filter = TextureFilterNearest,
+		.AddressMode = TextureAddressModeRepeat,
+		.LoadFromData = true,
+		.Data = data,
+	};
+	texture = TextureCreate(textureConfig);
+	TextureDataDestroy(data);
+	renderQueue = RenderQueueCreate(DrawCount);
+	
+	// The first frames grow the arenas, rings and lists to the size the frame needs
+	int frame = 0;
+	for (; frame < WarmupFrames; frame++) { RenderFrame(frame); }
+	SDL_AtomicSet(&Allocations, 0);
+	SDL_AtomicSet(&Counting, 1);
+	for (; frame < WarmupFrames + CountedFrames; frame++) { RenderFrame(frame); }
+	SDL_AtomicSet(&Counting, 0);
+	int allocations = SDL_AtomicGet(&Allocations);
+	printf("%i heap allocations in %i steady-state frames\n", allocations, CountedFrames);
+	
+	GraphicsStopOperations();
+	RenderQueueDestroy(renderQueue);
+	TextureDestroy(texture);
+	UniformBufferDestroy(uniformBuffer);
+	VertexBufferDestroy(dynamicBuffer);
+	VertexBufferDestroy(vertexBuffer);
+	PipelineDestroy(texturePipeline);
+	PipelineDestroy(uniformPipeline);
+	PipelineDestroy(flatPipeline);
+	VertexLayoutDestroy(textureLayout);
+	VertexLayoutDestroy(vertexLayout);
+	FrameBufferDestroy(frameBuffer);
+	XGIDeinitialize();
+	return allocations == 0 ? 0 : 1;
+}
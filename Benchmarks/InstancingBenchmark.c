@@ -0,0 +1,141 @@
+#include "Benchmark.h"
+
+// Draws 100,000 quads a frame with one GraphicsRenderInstanced call, and with a push constant update and a draw call for each quad.
+// Prints the cpu time recording took and the time of a whole frame, which includes waiting for the gpu to finish the frame before it
+
+#define InstanceCount 100000
+#define WarmupFrames 10
+#define TimedFrames 100
+
+typedef struct Vertex
+{
+	Vector3 Position;
+} Vertex;
+
+typedef struct Instance
+{
+	Vector2 Offset;
+} Instance;
+
+FrameBuffer frameBuffer;
+VertexLayout flatLayout;
+VertexLayout instancedLayout;
+Pipeline flatPipeline;
+Pipeline instancedPipeline;
+ShaderVariable transform;
+VertexBuffer quad;
+VertexBuffer instances;
+Vector2 offsets[InstanceCount];
+
+static void RecordInstanced()
+{
+	GraphicsBindPipeline(instancedPipeline);
+	GraphicsRenderInstanced(quad, instances, InstanceCount);
+}
+
+static void RecordPerDraw()
+{
+	for (int i = 0; i < InstanceCount; i++)
+	{
+		Matrix4x4 matrix = Matrix4x4FromTranslate((Vector3){ offsets[i].X, offsets[i].Y, 0.0f });
+		PipelineSetPushConstantHandle(flatPipeline, transform, &matrix);
+		GraphicsBindPipeline(flatPipeline);
+		GraphicsRenderVertexBuffer(quad);
+	}
+}
+
+static void TimeFrames(const char * name, void (*record)(void))
+{
+	double recording = 0.0, frames = 0.0;
+	double previous = BenchmarkTime();
+	for (int frame = 0; frame < WarmupFrames + TimedFrames; frame++)
+	{
+		GraphicsAquireNextImage();
+		GraphicsBegin(frameBuffer);
+		GraphicsClearColor(ColorFromHex(0x000000ff));
+		double start = BenchmarkTime();
+		record();
+		double end = BenchmarkTime();
+		GraphicsEnd();
+		GraphicsPresent();
+		double now = BenchmarkTime();
+		if (frame >= WarmupFrames)
+		{
+			recording += end - start;
+			frames += now - previous;
+		}
+		previous = now;
+	}
+	printf("%-16s %10.3f ms recording %10.3f ms a frame\n", name, recording / TimedFrames, frames / TimedFrames);
+}
+
+int main(int argc, char * argv[])
+{
+	BenchmarkInitialize();
+	
+	frameBuffer = BenchmarkCreateFrameBuffer();
+	VertexAttribute meshAttributes[] = { VertexAttributeVector3 };
+	flatLayout = VertexLayoutCreate(1, meshAttributes);
+	flatPipeline = BenchmarkCreateFlatPipeline(flatLayout);
+	transform = PipelineGetPushConstantHandle(flatPipeline, "Transform");
+	
+	VertexAttribute instanceAttributes[] = { VertexAttributeVector2 };
+	VertexBindingConfigure bindings[] =
+	{
+		{ .InputRate = VertexInputRateVertex, .AttributeCount = 1, .Attributes = meshAttributes },
+		{ .InputRate = VertexInputRateInstance, .AttributeCount = 1, .Attributes = instanceAttributes },
+	};
+	instancedLayout = VertexLayoutCreateBindings(2, bindings);
+	PipelineConfigure config =
+	{
+		.VertexLayout = instancedLayout,
+		.ShaderCount = 2,
+		.Shaders =
+		{
+			ShaderDataFromFile(ShaderTypeVertex, "Benchmarks/Shaders/Instanced.vert", false),
+			ShaderDataFromFile(ShaderTypeFragment, "Benchmarks/Shaders/Flat.frag", false),
+		},
+		.Primitive = VertexPrimitiveTriangleList,
+		.LineWidth = 1.0,
+		.PolygonMode = PolygonModeFill,
+		.CullMode = CullModeNone,
+		.CullClockwise = true,
+	};
+	instancedPipeline = PipelineCreate(config);
+	ShaderDataDestroy(config.Shaders[0]);
+	ShaderDataDestroy(config.Shaders[1]);
+	
+	// A small quad made of two triangles
+	quad = VertexBufferCreate(6, sizeof(Vertex));
+	Vertex * vertices = VertexBufferMapVertices(quad);
+	Vector2 corners[] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+	for (int i = 0; i < 6; i++) { vertices[i] = (Vertex){ { corners[i].X * 0.005f, corners[i].Y * 0.005f, 0.0f } }; }
+	VertexBufferUnmapVertices(quad);
+	VertexBufferUpload(quad);
+	
+	// The quads are spread over the framebuffer in a grid
+	instances = VertexBufferCreate(InstanceCount, sizeof(Instance));
+	Instance * instanceData = VertexBufferMapVertices(instances);
+	for (int i = 0; i < InstanceCount; i++)
+	{
+		offsets[i] = (Vector2){ -1.0f + (i % 400) / 200.0f, -1.0f + (i / 400) / 125.0f };
+		instanceData[i] = (Instance){ offsets[i] };
+	}
+	VertexBufferUnmapVertices(instances);
+	VertexBufferUpload(instances);
+	
+	printf("Drawing %i quads a frame, averaged over %i frames\n", InstanceCount, TimedFrames);
+	TimeFrames("Draw per quad", RecordPerDraw);
+	TimeFrames("Instanced", RecordInstanced);
+	
+	GraphicsStopOperations();
+	VertexBufferDestroy(instances);
+	VertexBufferDestroy(quad);
+	PipelineDestroy(instancedPipeline);
+	PipelineDestroy(flatPipeline);
+	VertexLayoutDestroy(instancedLayout);
+	VertexLayoutDestroy(flatLayout);
+	FrameBufferDestroy(frameBuffer);
+	XGIDeinitialize();
+	return 0;
+}
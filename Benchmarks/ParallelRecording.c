@@ -0,0 +1,105 @@
+#include "Benchmark.h"
+
+// Records 50,000 draws a frame on the main thread, then split between 1 to N record jobs with GraphicsRecordParallel,
+// and prints the cpu time recording took for each so that the scaling with the number of threads can be seen
+
+#define DrawCount 50000
+#define WarmupFrames 10
+#define TimedFrames 100
+
+typedef struct Vertex
+{
+	Vector3 Position;
+} Vertex;
+
+// The draws that one record job records
+typedef struct DrawRange
+{
+	int First;
+	int Count;
+} DrawRange;
+
+FrameBuffer frameBuffer;
+VertexLayout vertexLayout;
+Pipeline pipeline;
+VertexBuffer vertexBuffer;
+
+static void RecordDraws(void * data)
+{
+	DrawRange * range = data;
+	GraphicsBindPipeline(pipeline);
+	for (int i = range->First; i < range->First + range->Count; i++) { GraphicsRenderVertexRange(vertexBuffer, (i % 64) * 3, 3); }
+}
+
+// Times the recording of the frame's draws split between jobCount record jobs, 0 records them without GraphicsRecordParallel.
+// Returns the average in milliseconds
+static double TimeFrames(int jobCount)
+{
+	GraphicsRecordJob jobs[256];
+	DrawRange ranges[256];
+	for (int i = 0; i < jobCount; i++)
+	{
+		ranges[i] = (DrawRange){ .First = DrawCount * i / jobCount, .Count = DrawCount * (i + 1) / jobCount - DrawCount * i / jobCount };
+		jobs[i] = (GraphicsRecordJob){ .Function = RecordDraws, .Data = ranges + i };
+	}
+	DrawRange all = { .First = 0, .Count = DrawCount };
+	
+	double total = 0.0;
+	for (int frame = 0; frame < WarmupFrames + TimedFrames; frame++)
+	{
+		GraphicsAquireNextImage();
+		GraphicsBegin(frameBuffer);
+		GraphicsClearColor(ColorFromHex(0x000000ff));
+		double start = BenchmarkTime();
+		if (jobCount == 0) { RecordDraws(&all); }
+		else { GraphicsRecordParallel(jobs, jobCount); }
+		double end = BenchmarkTime();
+		GraphicsEnd();
+		GraphicsPresent();
+		if (frame >= WarmupFrames) { total += end - start; }
+	}
+	return total / TimedFrames;
+}
+
+int main(int argc, char * argv[])
+{
+	BenchmarkInitialize();
+	
+	frameBuffer = BenchmarkCreateFrameBuffer();
+	VertexAttribute attributes[] = { VertexAttributeVector3 };
+	vertexLayout = VertexLayoutCreate(1, attributes);
+	pipeline = BenchmarkCreateFlatPipeline(vertexLayout);
+	PipelineSetPushConstant(pipeline, "Transform", &Matrix4x4Identity);
+	
+	// 64 small triangles along the diagonal, each draw picks one so that the draws aren't all the same
+	vertexBuffer = VertexBufferCreate(64 * 3, sizeof(Vertex));
+	Vertex * vertices = VertexBufferMapVertices(vertexBuffer);
+	for (int i = 0; i < 64; i++)
+	{
+		Scalar x = -1.0f + i / 32.0f;
+		vertices[i * 3 + 0] = (Vertex){ { x, x, 0.0f } };
+		vertices[i * 3 + 1] = (Vertex){ { x + 0.03f, x, 0.0f } };
+		vertices[i * 3 + 2] = (Vertex){ { x, x + 0.03f, 0.0f } };
+	}
+	VertexBufferUnmapVertices(vertexBuffer);
+	VertexBufferUpload(vertexBuffer);
+	
+	// The thread waiting on the record jobs runs them too, so there can be one more job than worker threads running at once
+	int maxJobs = MIN(JobSystemGetThreadCount() + 1, 256);
+	printf("Recording %i draws a frame, averaged over %i frames\n", DrawCount, TimedFrames);
+	double single = TimeFrames(0);
+	printf("%-12s %10.3f ms\n", "Inline", single);
+	for (int jobCount = 1; jobCount <= maxJobs; jobCount++)
+	{
+		double time = TimeFrames(jobCount);
+		printf("%2i thread(s) %10.3f ms %6.2fx\n", jobCount, time, single / time);
+	}
+	
+	GraphicsStopOperations();
+	VertexBufferDestroy(vertexBuffer);
+	PipelineDestroy(pipeline);
+	FrameBufferDestroy(frameBuffer);
+	VertexLayoutDestroy(vertexLayout);
+	XGIDeinitialize();
+	return 0;
+}
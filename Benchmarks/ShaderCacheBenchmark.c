@@ -0,0 +1,67 @@
+#include "Benchmark.h"
+
+// Times loading the example's GLSL shaders with ShaderDataFromFile with a cold and a warm shader cache, and cold with ShaderDataFromFiles.
+// Cold loads run with the cache turned off so every load compiles with shaderc like the first run does, the time to write the cache isn't included.
+// Warm loads map the compiled SPIR-V from the cache directory
+
+#define RoundCount 20
+
+static const char * Files[] = { "Example/Shaders/Default.vert", "Example/Shaders/Default.frag" };
+static const ShaderType Types[] = { ShaderTypeVertex, ShaderTypeFragment };
+
+// Returns the average time in milliseconds to load both shaders
+static double TimeLoads()
+{
+	double start = BenchmarkTime();
+	for (int round = 0; round < RoundCount; round++)
+	{
+		for (int i = 0; i < 2; i++) { ShaderDataDestroy(ShaderDataFromFile(Types[i], Files[i], false)); }
+	}
+	return (BenchmarkTime() - start) / RoundCount;
+}
+
+// Returns the average time in milliseconds to load both shaders at once, they're compiled in parallel on the worker threads
+static double TimeBatchedLoads()
+{
+	ShaderData data[2];
+	double start = BenchmarkTime();
+	for (int round = 0; round < RoundCount; round++)
+	{
+		ShaderDataFromFiles(Types, Files, 2, false, data);
+		for (int i = 0; i < 2; i++) { ShaderDataDestroy(data[i]); }
+	}
+	return (BenchmarkTime() - start) / RoundCount;
+}
+
+int main(int argc, char * argv[])
+{
+	BenchmarkInitialize();
+	printf("Loading %s and %s, averaged over %i loads\n", Files[0], Files[1], RoundCount);
+	
+	Graphics.ShaderCachePath = NULL;
+	double cold = TimeLoads();
+	int misses = SDL_AtomicGet(&Graphics.Statistics.ShaderCacheMisses);
+	printf("%-14s %10.3f ms %4i compiled\n", "Cold", cold, misses);
+	double batched = TimeBatchedLoads();
+	printf("%-14s %10.3f ms %4i compiled %6.1fx\n", "Cold, batched", batched, SDL_AtomicGet(&Graphics.Statistics.ShaderCacheMisses) - misses, cold / batched);
+	
+	const char * cachePath = "ShaderCache";
+	if (!FileCreateDirectory(cachePath))
+	{
+		printf("Unable to create the shader cache directory %s\n", cachePath);
+		return 1;
+	}
+	Graphics.ShaderCachePath = cachePath;
+	// The first load fills the cache if it's empty
+	for (int i = 0; i < 2; i++) { ShaderDataDestroy(ShaderDataFromFile(Types[i], Files[i], false)); }
+	int hits = SDL_AtomicGet(&Graphics.Statistics.ShaderCacheHits);
+	misses = SDL_AtomicGet(&Graphics.Statistics.ShaderCacheMisses);
+	double warm = TimeLoads();
+	hits = SDL_AtomicGet(&Graphics.Statistics.ShaderCacheHits) - hits;
+	misses = SDL_AtomicGet(&Graphics.Statistics.ShaderCacheMisses) - misses;
+	printf("%-14s %10.3f ms %4i cached %i compiled %6.1fx\n", "Warm", warm, hits, misses, cold / warm);
+	
+	GraphicsStopOperations();
+	XGIDeinitialize();
+	return 0;
+}
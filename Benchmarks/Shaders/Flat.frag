@@ -0,0 +1,8 @@
+#version 450
+
+layout (location = 0) out vec4 FragColor;
+
+void main()
+{
+	FragColor = vec4(0.25, 0.5, 1.0, 1.0);
+}
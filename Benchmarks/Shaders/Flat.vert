@@ -0,0 +1,13 @@
+#version 450
+
+layout (location = 0) in vec3 PositionAttribute;
+
+layout (push_constant) uniform PushConstant
+{
+	mat4 Transform;
+} Input;
+
+void main()
+{
+	gl_Position = Input.Transform * vec4(PositionAttribute, 1.0);
+}
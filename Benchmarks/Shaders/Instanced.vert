@@ -0,0 +1,9 @@
+#version 450
+
+layout (location = 0) in vec3 PositionAttribute;
+layout (location = 1) in vec2 OffsetAttribute;
+
+void main()
+{
+	gl_Position = vec4(PositionAttribute.xy + OffsetAttribute, PositionAttribute.z, 1.0);
+}
@@ -0,0 +1,48 @@
+#include "Benchmark.h"
+
+// Decodes a set of image files with TextureDataFromFiles using 1 to N threads and prints the images per second for each.
+// Pass the files to decode, for example Benchmarks/TextureDecodeBenchmark textures/*.png, without any the example's texture is decoded 256 times.
+// Only the job system is initialized since decoding doesn't touch the gpu
+
+#define DefaultFileCount 256
+#define RoundCount 3
+
+int main(int argc, char * argv[])
+{
+	const char ** files = (const char **)argv + 1;
+	int count = argc - 1;
+	if (count == 0)
+	{
+		count = DefaultFileCount;
+		files = malloc(count * sizeof(const char *));
+		for (int i = 0; i < count; i++) { files[i] = "Example/texture.jpg"; }
+	}
+	TextureData * data = malloc(count * sizeof(TextureData));
+	
+	int cores = SDL_GetCPUCount();
+	printf("Decoding %i images on up to %i cores, the best of %i rounds\n", count, cores, RoundCount);
+	double single = 0.0;
+	for (int threads = 1; threads <= cores; threads++)
+	{
+		// One thread decodes the files one at a time with TextureDataFromFile.
+		// Otherwise the thread that calls TextureDataFromFiles decodes too, so there's one less worker than threads
+		if (threads > 1) { JobSystemInitialize(threads - 1); }
+		double best = 0.0;
+		for (int round = 0; round < RoundCount; round++)
+		{
+			double start = BenchmarkTime();
+			if (threads == 1) { for (int i = 0; i < count; i++) { data[i] = TextureDataFromFile(files[i]); } }
+			else { TextureDataFromFiles(files, count, data); }
+			double end = BenchmarkTime();
+			for (int i = 0; i < count; i++) { TextureDataDestroy(data[i]); }
+			best = MAX(best, count / ((end - start) / 1000.0));
+		}
+		if (threads > 1) { JobSystemDeinitialize(); }
+		if (threads == 1) { single = best; }
+		printf("%2i thread(s) %10.1f images/s %6.2fx\n", threads, best, best / single);
+	}
+	
+	free(data);
+	if (argc == 1) { free(files); }
+	return 0;
+}
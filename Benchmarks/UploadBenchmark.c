@@ -0,0 +1,139 @@
+#include "Benchmark.h"
+
+// Uploads 1,000 vertex buffers every frame and prints the queue submits and cpu time per frame.
+// VertexBufferUpload records every copy of the frame into one command buffer that's submitted with the frame,
+// it's compared with how uploads used to be done: a command buffer, fence and vkQueueSubmit for each buffer.
+// The old semaphore wait per upload in GraphicsPresent isn't reproduced, so the old way is timed a little faster than it was
+
+#define UploadCount 1000
+#define VertexCount 64
+#define WarmupFrames 10
+#define TimedFrames 100
+
+typedef struct Vertex
+{
+	Vector3 Position;
+} Vertex;
+
+VertexBuffer vertexBuffers[UploadCount];
+
+// What every buffer used to own for its uploads
+VkCommandPool commandPool;
+VkCommandBuffer commandBuffers[UploadCount];
+VkFence fences[UploadCount];
+
+static void FillVertices(Vertex * vertices, int seed)
+{
+	for (int i = 0; i < VertexCount; i++) { vertices[i] = (Vertex){ { (Scalar)(seed + i), (Scalar)seed, 0.0f } }; }
+}
+
+static void UploadBatched(int frame)
+{
+	for (int i = 0; i < UploadCount; i++)
+	{
+		FillVertices(VertexBufferMapVertices(vertexBuffers[i]), frame + i);
+		VertexBufferUnmapVertices(vertexBuffers[i]);
+		VertexBufferUpload(vertexBuffers[i]);
+	}
+}
+
+static void UploadSubmitEach(int frame)
+{
+	size_t size = VertexCount * sizeof(Vertex);
+	for (int i = 0; i < UploadCount; i++)
+	{
+		TransferStaging staging = TransferStagingAllocate(size);
+		FillVertices(staging.Data, frame + i);
+		vkWaitForFences(Graphics.Device, 1, fences + i, VK_TRUE, UINT64_MAX);
+		vkResetFences(Graphics.Device, 1, fences + i);
+		
+		VkCommandBufferBeginInfo beginInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		};
+		vkBeginCommandBuffer(commandBuffers[i], &beginInfo);
+		VkBufferCopy copyInfo =
+		{
+			.srcOffset = staging.Offset,
+			.dstOffset = 0,
+			.size = size,
+		};
+		vkCmdCopyBuffer(commandBuffers[i], staging.Buffer, vertexBuffers[i]->VertexBuffer, 1, &copyInfo);
+		vkEndCommandBuffer(commandBuffers[i]);
+		VkSubmitInfo submitInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.commandBufferCount = 1,
+			.pCommandBuffers = commandBuffers + i,
+		};
+		vkQueueSubmit(Graphics.GraphicsQueue, 1, &submitInfo, fences[i]);
+		SDL_AtomicAdd(&Graphics.Statistics.QueueSubmits, 1);
+		TransferStagingRelease(staging);
+	}
+}
+
+// Prints the average submits and cpu time of a frame, the time waiting for the frame resource's fence isn't counted
+static void TimeFrames(const char * name, void (*upload)(int frame))
+{
+	double time = 0.0;
+	int submits = 0;
+	for (int frame = 0; frame < WarmupFrames + TimedFrames; frame++)
+	{
+		GraphicsAquireNextImage();
+		int startSubmits = SDL_AtomicGet(&Graphics.Statistics.QueueSubmits);
+		double start = BenchmarkTime();
+		upload(frame);
+		GraphicsPresent();
+		double end = BenchmarkTime();
+		if (frame < WarmupFrames) { continue; }
+		time += end - start;
+		submits += SDL_AtomicGet(&Graphics.Statistics.QueueSubmits) - startSubmits;
+	}
+	printf("%-24s %8.1f submits %10.3f ms\n", name, (double)submits / TimedFrames, time / TimedFrames);
+}
+
+int main(int argc, char * argv[])
+{
+	BenchmarkInitialize();
+	
+	VkCommandPoolCreateInfo poolInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = Graphics.GraphicsQueueIndex,
+	};
+	vkCreateCommandPool(Graphics.Device, &poolInfo, NULL, &commandPool);
+	VkCommandBufferAllocateInfo allocateInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandPool = commandPool,
+		.commandBufferCount = UploadCount,
+	};
+	vkAllocateCommandBuffers(Graphics.Device, &allocateInfo, commandBuffers);
+	VkFenceCreateInfo fenceInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+		.flags = VK_FENCE_CREATE_SIGNALED_BIT,
+	};
+	for (int i = 0; i < UploadCount; i++)
+	{
+		vkCreateFence(Graphics.Device, &fenceInfo, NULL, fences + i);
+		vertexBuffers[i] = VertexBufferCreate(VertexCount, sizeof(Vertex));
+	}
+	
+	printf("Uploading %i vertex buffers of %i bytes a frame, averaged over %i frames\n", UploadCount, (int)(VertexCount * sizeof(Vertex)), TimedFrames);
+	TimeFrames("Submit for each upload", UploadSubmitEach);
+	TimeFrames("Batched with the frame", UploadBatched);
+	
+	GraphicsStopOperations();
+	for (int i = 0; i < UploadCount; i++)
+	{
+		vkDestroyFence(Graphics.Device, fences[i], NULL);
+		VertexBufferDestroy(vertexBuffers[i]);
+	}
+	vkDestroyCommandPool(Graphics.Device, commandPool, NULL);
+	XGIDeinitialize();
+	return 0;
+}
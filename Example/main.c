@@ -13,7 +13,8 @@ typedef struct Vertex
 FrameBuffer frameBuffer;   // You need at least one framebuffer to render to
 VertexLayout vertexLayout; // Needed for describing the custom vertex to the pipeline
 Pipeline pipeline;         // Enscapulates shaders and other configuration into a state object
-VertexBuffer vertexBuffer; // The quad used for rendering
+VertexBuffer vertexBuffer; // The vertices of the quad used for rendering
+IndexBuffer indexBuffer;   // The order the quad's vertices are rendered in
 Texture texture;           // The texture used to render on the quad
 
 // This is a callback function that is registered with the eventhandler below
@@ -46,6 +47,8 @@ int main(int argc, char * argv[])
 	{
 		.VulkanValidation = true,
 		.FrameResourceCount = 3,
+		.PipelineCachePath = "PipelineCache.bin",
+		.ShaderCachePath = "ShaderCache",
 	};
 	XGIInitialize(windowConfig, graphicsConfig);
 	
@@ -85,18 +88,27 @@ int main(int argc, char * argv[])
 		.StencilTest = false,
 	};
 	pipeline = PipelineCreate(pipelineConfig);
+	// The shader datas can be freed once the pipeline is created
+	ShaderDataDestroy(pipelineConfig.Shaders[0]);
+	ShaderDataDestroy(pipelineConfig.Shaders[1]);
 
 	// Create the vertex buffer
-	vertexBuffer = VertexBufferCreate(6, sizeof(Vertex));
+	vertexBuffer = VertexBufferCreate(4, sizeof(Vertex));
 	Vertex * vertices = VertexBufferMapVertices(vertexBuffer);
 	vertices[0] = (Vertex){ { -1.0, -1.0, 0.0 }, { 0.0, 0.0 } };
 	vertices[1] = (Vertex){ { 1.0, -1.0, 0.0 }, { 1.0, 0.0 } };
 	vertices[2] = (Vertex){ { 1.0, 1.0, 0.0 }, { 1.0, 1.0 } };
-	vertices[3] = vertices[0];
-	vertices[4] = vertices[2];
-	vertices[5] = (Vertex){ { -1.0, 1.0, 0.0 }, { 0.0, 1.0 } };
+	vertices[3] = (Vertex){ { -1.0, 1.0, 0.0 }, { 0.0, 1.0 } };
 	VertexBufferUnmapVertices(vertexBuffer);
 	VertexBufferUpload(vertexBuffer);
+	
+	// Create the index buffer, the two triangles share the corners at index 0 and 2
+	indexBuffer = IndexBufferCreate(6, IndexType16, true);
+	uint16_t * indices = IndexBufferMapIndices(indexBuffer);
+	indices[0] = 0; indices[1] = 1; indices[2] = 2;
+	indices[3] = 0; indices[4] = 2; indices[5] = 3;
+	IndexBufferUnmapIndices(indexBuffer);
+	IndexBufferUpload(indexBuffer);
 
 	// Create the texture
 	TextureData data = TextureDataFromFile("Example/texture.jpg");
@@ -117,6 +129,9 @@ int main(int argc, char * argv[])
 	EventHandlerAddCallback(EventTypeKeyPressed, (void (*)(void))OnKeyPressed);
 	EventHandlerAddCallback(EventTypeWindowResized, (void (*)(void))OnResize);
 	
+	// Look up the push constant member once instead of by name every frame
+	ShaderVariable transform = PipelineGetPushConstantHandle(pipeline, "Transform");
+	
 	// Start the main loop
 	while (WindowRunning())
 	{
@@ -124,7 +139,7 @@ int main(int argc, char * argv[])
 		
 		// Update code starts here
 		// Set the push constant
-		PipelineSetPushConstant(pipeline, "Transform", &Matrix4x4Identity);
+		PipelineSetPushConstantHandle(pipeline, transform, &Matrix4x4Identity);
 
 		GraphicsAquireNextImage();
 		
@@ -132,7 +147,7 @@ int main(int argc, char * argv[])
 		GraphicsBegin(frameBuffer);
 		GraphicsClearColor(ColorFromHex(0x204080ff));
 		GraphicsBindPipeline(pipeline);
-		GraphicsRenderVertexBuffer(vertexBuffer);
+		GraphicsRenderIndexed(vertexBuffer, indexBuffer, 0, 6);
 		GraphicsEnd();
 		// Copy the framebuffer to the swapchain for rendering
 		GraphicsCopyToSwapchain(frameBuffer);
@@ -143,6 +158,7 @@ int main(int argc, char * argv[])
 
 	// Deinitialization code starts here
 	TextureDestroy(texture);
+	IndexBufferDestroy(indexBuffer);
 	VertexBufferDestroy(vertexBuffer);
 	PipelineDestroy(pipeline);
 	FrameBufferDestroy(frameBuffer);
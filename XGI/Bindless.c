@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <SDL2/SDL_mutex.h>
+#include "Bindless.h"
+#include "Graphics.h"
+#include "log.h"
+
+static struct Bindless
+{
+	SDL_mutex * Mutex;
+	VkDescriptorSetLayout Layout;
+	VkDescriptorSetLayout EmptyLayout;
+	VkDescriptorPool Pool;
+	VkDescriptorSet Set;
+	int Capacity;
+	/// Indices below this have been handed out at least once
+	int NextIndex;
+	/// A stack of the indices of removed textures
+	int * FreeIndices;
+	int FreeCount;
+} Bindless = { 0 };
+
+static void CreateTableLayout()
+{
+	// Partially bound lets most of the table be empty, update after bind lets textures be added while frames using the table are recorded or executing
+	VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT;
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT,
+		.bindingCount = 1,
+		.pBindingFlags = &bindingFlags,
+	};
+	VkDescriptorSetLayoutBinding binding =
+	{
+		.binding = 0,
+		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.descriptorCount = Bindless.Capacity,
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+	};
+	VkDescriptorSetLayoutCreateInfo layoutInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = &bindingFlagsInfo,
+		.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT,
+		.bindingCount = 1,
+		.pBindings = &binding,
+	};
+	VkResult result = vkCreateDescriptorSetLayout(Graphics.Device, &layoutInfo, NULL, &Bindless.Layout);
+	if (result != VK_SUCCESS)
+	{
+		log_fatal("Unable to create the bindless texture table layout: %i\n", result);
+		exit(1);
+	}
+}
+
+static void CreateTableSet()
+{
+	VkDescriptorPoolSize poolSize =
+	{
+		.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.descriptorCount = Bindless.Capacity,
+	};
+	VkDescriptorPoolCreateInfo poolInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT,
+		.maxSets = 1,
+		.poolSizeCount = 1,
+		.pPoolSizes = &poolSize,
+	};
+	vkCreateDescriptorPool(Graphics.Device, &poolInfo, NULL, &Bindless.Pool);
+	VkDescriptorSetAllocateInfo allocateInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool = Bindless.Pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &Bindless.Layout,
+	};
+	vkAllocateDescriptorSets(Graphics.Device, &allocateInfo, &Bindless.Set);
+}
+
+void BindlessInitialize(int textureCount)
+{
+	VkDescriptorSetLayoutCreateInfo emptyLayoutInfo = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+	vkCreateDescriptorSetLayout(Graphics.Device, &emptyLayoutInfo, NULL, &Bindless.EmptyLayout);
+	if (!Graphics.DescriptorIndexing)
+	{
+		log_info("Descriptor indexing isn't supported, there will be no bindless texture table\n");
+		return;
+	}
+
+	Bindless.Mutex = SDL_CreateMutex();
+	Bindless.Capacity = MIN(textureCount > 0 ? textureCount : 4096, (int)Graphics.MaxBindlessTextures);
+	Bindless.FreeIndices = malloc(Bindless.Capacity * sizeof(int));
+	CreateTableLayout();
+	CreateTableSet();
+}
+
+int BindlessAddTexture(VkImageView imageView, VkSampler sampler)
+{
+	if (Bindless.Set == VK_NULL_HANDLE) { return -1; }
+	SDL_LockMutex(Bindless.Mutex);
+	int index = -1;
+	if (Bindless.FreeCount > 0) { index = Bindless.FreeIndices[--Bindless.FreeCount]; }
+	else if (Bindless.NextIndex < Bindless.Capacity) { index = Bindless.NextIndex++; }
+	if (index == -1)
+	{
+		SDL_UnlockMutex(Bindless.Mutex);
+		log_warn("The bindless texture table is full, the texture can't be sampled by index\n");
+		return -1;
+	}
+
+	// The write is made right away, the index can't be in use by any frame since it was free
+	VkDescriptorImageInfo imageInfo =
+	{
+		.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+		.imageView = imageView,
+		.sampler = sampler,
+	};
+	VkWriteDescriptorSet write =
+	{
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = Bindless.Set,
+		.dstBinding = 0,
+		.dstArrayElement = index,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.pImageInfo = &imageInfo,
+	};
+	vkUpdateDescriptorSets(Graphics.Device, 1, &write, 0, NULL);
+	SDL_UnlockMutex(Bindless.Mutex);
+	return index;
+}
+
+void BindlessRemoveTexture(int index)
+{
+	if (index < 0 || Bindless.Set == VK_NULL_HANDLE) { return; }
+	// The descriptor is left as it is, partially bound means it's fine as long as no shader reads it
+	SDL_LockMutex(Bindless.Mutex);
+	Bindless.FreeIndices[Bindless.FreeCount++] = index;
+	SDL_UnlockMutex(Bindless.Mutex);
+}
+
+VkDescriptorSetLayout BindlessGetLayout()
+{
+	return Bindless.Layout;
+}
+
+VkDescriptorSetLayout BindlessGetEmptyLayout()
+{
+	return Bindless.EmptyLayout;
+}
+
+VkDescriptorSet BindlessGetSet()
+{
+	return Bindless.Set;
+}
+
+void BindlessDeinitialize()
+{
+	vkDestroyDescriptorSetLayout(Graphics.Device, Bindless.EmptyLayout, NULL);
+	if (Bindless.Set == VK_NULL_HANDLE) { return; }
+	vkDestroyDescriptorPool(Graphics.Device, Bindless.Pool, NULL);
+	vkDestroyDescriptorSetLayout(Graphics.Device, Bindless.Layout, NULL);
+	free(Bindless.FreeIndices);
+	SDL_DestroyMutex(Bindless.Mutex);
+	Bindless = (struct Bindless){ 0 };
+}
@@ -0,0 +1,43 @@
+#ifndef Bindless_h
+#define Bindless_h
+
+#include <vulkan/vulkan.h>
+
+/// The descriptor set that shaders declare the texture table at, as an unsized array at binding 0:
+/// layout(set = 1, binding = 0) uniform sampler2D Textures[];
+/// A pipeline that declares it has the table bound automatically, the index to sample is usually given with a push constant
+#define BindlessSet 1
+
+/// This should not be called by the user, it is called in the GraphicsInitialize function.
+/// The table is only created if the device supports descriptor indexing
+/// \param textureCount The number of textures the table can hold, 0 defaults to 4096
+void BindlessInitialize(int textureCount);
+
+/// Adds a texture to the table so that it can be sampled by index from any pipeline.
+/// This can be called from any thread. The user shouldn't need to call this, every texture with a 2D view is added when it's created
+/// \param imageView The image view of the texture
+/// \param sampler The sampler of the texture
+/// \return The index of the texture in the table, -1 if the device doesn't support descriptor indexing or the table is full
+int BindlessAddTexture(VkImageView imageView, VkSampler sampler);
+
+/// Frees the index of a texture so that it can be reused, the gpu must be finished using it.
+/// This can be called from any thread. The user shouldn't need to call this
+/// \param index The index from BindlessAddTexture, -1 is ignored
+void BindlessRemoveTexture(int index);
+
+/// Gets the layout of the table for creating pipeline layouts
+/// \return The descriptor set layout, VK_NULL_HANDLE if there isn't a table
+VkDescriptorSetLayout BindlessGetLayout(void);
+
+/// Gets an empty descriptor set layout used to fill in the sets before the table that a pipeline doesn't use
+/// \return The empty descriptor set layout
+VkDescriptorSetLayout BindlessGetEmptyLayout(void);
+
+/// Gets the descriptor set of the table, it's shared by every frame resource and can be bound at any time
+/// \return The descriptor set, VK_NULL_HANDLE if there isn't a table
+VkDescriptorSet BindlessGetSet(void);
+
+/// This should not be called by the user, it is called in the GraphicsDeinitialize function
+void BindlessDeinitialize(void);
+
+#endif
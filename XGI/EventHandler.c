@@ -1,6 +1,7 @@
 #include "EventHandler.h"
 #include "Window.h"
 #include "Graphics.h"
+#include "Instrument.h"
 
 struct f_pointer { void (*function)(void); };
 
@@ -49,6 +50,7 @@ void EventHandlerDeinitialize()
 
 void EventHandlerPoll()
 {
+	INSTRUMENT_BEGIN("EventHandlerPoll");
 	SDL_Event event;
 	while (SDL_PollEvent(&event))
 	{
@@ -147,6 +149,7 @@ void EventHandlerPoll()
 				break;
 		}
 	}
+	INSTRUMENT_END();
 }
 
 static void CallAllFunctions(List list)
@@ -1,8 +1,17 @@
 #include <stdbool.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
 #include "File.h"
 #include "log.h"
 
-File FileOpen(const char * path, FileMode mode)
+File FileTryOpen(const char * path, FileMode mode)
 {
 	File file = malloc(sizeof(struct File));
 	*file = (struct File) { .Path = path, };
@@ -20,11 +29,22 @@ File FileOpen(const char * path, FileMode mode)
 	}
 	file->RW = SDL_RWFromFile(path, fileMode);
 	if (file->RW == NULL)
+	{
+		free(file);
+		return NULL;
+	}
+	file->Size = SDL_RWsize(file->RW);
+	return file;
+}
+
+File FileOpen(const char * path, FileMode mode)
+{
+	File file = FileTryOpen(path, mode);
+	if (file == NULL)
 	{
 		log_fatal("%s doesn't exist.\n", path);
 		exit(1);
 	}
-	file->Size = SDL_RWsize(file->RW);
 	return file;
 }
 
@@ -59,6 +79,54 @@ bool FileExists(const char * path)
 	else { SDL_RWclose(file); return true; }
 }
 
+bool FileCreateDirectory(const char * path)
+{
+#ifdef _WIN32
+	if (CreateDirectoryA(path, NULL)) { return true; }
+	return GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+	if (mkdir(path, 0755) == 0) { return true; }
+	return errno == EEXIST;
+#endif
+}
+
+void * FileMap(const char * path, unsigned long * size)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) { return NULL; }
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { CloseHandle(file); return NULL; }
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) { return NULL; }
+	void * data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (data == NULL) { return NULL; }
+	*size = (unsigned long)fileSize.QuadPart;
+	return data;
+#else
+	int file = open(path, O_RDONLY);
+	if (file < 0) { return NULL; }
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0) { close(file); return NULL; }
+	void * data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED) { return NULL; }
+	*size = info.st_size;
+	return data;
+#endif
+}
+
+void FileUnmap(void * data, unsigned long size)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
 void FileClose(File file)
 {
 	SDL_RWclose(file->RW);
@@ -2,6 +2,7 @@
 #define File_h
 
 #include <stdio.h>
+#include <stdbool.h>
 #include <SDL2/SDL.h>
 
 typedef enum FileMode
@@ -47,6 +48,12 @@ typedef struct File
 /// \return The file object
 File FileOpen(const char * filePath, FileMode mode);
 
+/// Opens a file the same way as FileOpen, but doesn't exit if the file can't be opened
+/// \param filePath The file path
+/// \param mode The read/write mode to open the file with
+/// \return The file object, or NULL if the file couldn't be opened
+File FileTryOpen(const char * filePath, FileMode mode);
+
 /// Gets the size from a file object
 /// \param file The file object
 /// \return The file size
@@ -76,6 +83,22 @@ void FileWrite(File file, unsigned long offset, unsigned long size, void * data)
 /// \return Either true or false if it exists
 bool FileExists(const char * path);
 
+/// Creates a directory if it doesn't already exist
+/// \param path The path of the directory
+/// \return Whether or not the directory exists after the call
+bool FileCreateDirectory(const char * path);
+
+/// Maps a whole file into memory for reading
+/// \param path The path of the file to map
+/// \param size Set to the size of the file in bytes
+/// \return A read only pointer to the file contents, or NULL if the file couldn't be mapped
+void * FileMap(const char * path, unsigned long * size);
+
+/// Unmaps a file that was mapped with FileMap
+/// \param data The pointer returned by FileMap
+/// \param size The size returned by FileMap
+void FileUnmap(void * data, unsigned long size);
+
 /// Closes the file object
 /// \param file The file object to close
 void FileClose(File file);
@@ -72,7 +72,7 @@ FrameBuffer FrameBufferResize(FrameBuffer frameBuffer, unsigned int width, unsig
 
 void FrameBufferQueueDestroy(FrameBuffer frameBuffer)
 {
-	ListPush(Graphics.FrameResources[Graphics.FrameIndex].DestroyFrameBufferQueue, frameBuffer);
+	GraphicsQueueDestroy(GraphicsDestroyTypeFrameBuffer, frameBuffer);
 }
 
 void FrameBufferDestroy(FrameBuffer frameBuffer)
@@ -2,8 +2,13 @@
 #include <string.h>
 #include <stdio.h>
 #include "log.h"
+#include "File.h"
 #include "Graphics.h"
 #include "Window.h"
+#include "Instrument.h"
+#include "Transfer.h"
+#include "Bindless.h"
+#include "Job.h"
 #include "VertexBuffer.h"
 #include "LinearMath.h"
 
@@ -31,6 +36,9 @@ static bool CheckValidationLayerSupport()
 
 static void CheckExtensionSupport()
 {
+	// Without a window no instance extensions are needed
+	if (Graphics.Headless) { return; }
+	
 	unsigned int supportedExtensionCount;
 	vkEnumerateInstanceExtensionProperties(NULL, &supportedExtensionCount, NULL);
 	VkExtensionProperties * supportedExtensions = malloc(supportedExtensionCount * sizeof(VkExtensionProperties));
@@ -74,13 +82,18 @@ static void CreateInstance(bool vulkanValidation)
 		.applicationVersion = VK_MAKE_VERSION(0, 0, 0),
 		.pEngineName = "XGI",
 		.engineVersion = VK_MAKE_VERSION(1, 0, 0),
-		.apiVersion = VK_API_VERSION_1_0,
+		// 1.1 is needed to query extended device features such as descriptor indexing
+		.apiVersion = VK_API_VERSION_1_1,
 	};
 	
-	unsigned int extensionCount;
-	SDL_Vulkan_GetInstanceExtensions(Window.Handle, &extensionCount, NULL);
-	char ** extensionNames = (char ** )malloc(extensionCount * sizeof(char * ));
-	SDL_Vulkan_GetInstanceExtensions(Window.Handle, &extensionCount, (const char ** )extensionNames);
+	unsigned int extensionCount = 0;
+	char ** extensionNames = NULL;
+	if (!Graphics.Headless)
+	{
+		SDL_Vulkan_GetInstanceExtensions(Window.Handle, &extensionCount, NULL);
+		extensionNames = (char ** )malloc(extensionCount * sizeof(char * ));
+		SDL_Vulkan_GetInstanceExtensions(Window.Handle, &extensionCount, (const char ** )extensionNames);
+	}
 	
 	VkInstanceCreateInfo createInfo =
 	{
@@ -104,6 +117,11 @@ static void CreateInstance(bool vulkanValidation)
 
 static void CreateSurface()
 {
+	if (Graphics.Headless)
+	{
+		Graphics.Surface = VK_NULL_HANDLE;
+		return;
+	}
 	if (!SDL_Vulkan_CreateSurface(Window.Handle, Graphics.Instance, &Graphics.Surface))
 	{
 		log_fatal("Failed to create SurfaceKHR\n");
@@ -111,6 +129,26 @@ static void CreateSurface()
 	}
 }
 
+static bool CheckDeviceExtensionSupport(VkPhysicalDevice device, const char * extension)
+{
+	unsigned int availableExtensionCount;
+	vkEnumerateDeviceExtensionProperties(device, NULL, &availableExtensionCount, NULL);
+	VkExtensionProperties * availableExtensions = malloc(availableExtensionCount * sizeof(VkExtensionProperties));
+	vkEnumerateDeviceExtensionProperties(device, NULL, &availableExtensionCount, availableExtensions);
+	
+	bool supported = false;
+	for (int i = 0; i < availableExtensionCount; i++)
+	{
+		if (strcmp(availableExtensions[i].extensionName, extension) == 0)
+		{
+			supported = true;
+			break;
+		}
+	}
+	free(availableExtensions);
+	return supported;
+}
+
 static void ChoosePhysicalDevice(bool useIntegrated)
 {
 	Graphics.PhysicalDevice = VK_NULL_HANDLE;
@@ -142,7 +180,7 @@ static void ChoosePhysicalDevice(bool useIntegrated)
 				graphicsQueueIndex = j;
 			}
 			VkBool32 presentSupported = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(devices[i], j, Graphics.Surface, &presentSupported);
+			if (!Graphics.Headless) { vkGetPhysicalDeviceSurfaceSupportKHR(devices[i], j, Graphics.Surface, &presentSupported); }
 			if (queueFamilies[j].queueCount > 0 && presentSupported && presentQueueIndex == -1)
 			{
 				presentQueueIndex = j;
@@ -150,22 +188,11 @@ static void ChoosePhysicalDevice(bool useIntegrated)
 		}
 		free(queueFamilies);
 		
+		// Headless devices only need to render, the graphics queue stands in for the present queue
+		if (Graphics.Headless) { presentQueueIndex = graphicsQueueIndex; }
 		bool graphicsQueueSupported = graphicsQueueIndex > -1;
 		bool presentQueueSupported = presentQueueIndex > -1;
-		bool swapchainSupported = false;
-		
-		unsigned int availableExtensionCount;
-		vkEnumerateDeviceExtensionProperties(devices[i], NULL, &availableExtensionCount, NULL);
-		VkExtensionProperties * availableExtensions = malloc(availableExtensionCount * sizeof(VkExtensionProperties));
-		vkEnumerateDeviceExtensionProperties(devices[i], NULL, &availableExtensionCount, availableExtensions);
-		for (int i = 0; i < availableExtensionCount; i++)
-		{
-			if (strcmp(availableExtensions[i].extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0)
-			{
-				swapchainSupported = true;
-			}
-		}
-		free(availableExtensions);
+		bool swapchainSupported = Graphics.Headless || CheckDeviceExtensionSupport(devices[i], VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 		
 		if (graphicsQueueSupported && presentQueueSupported && swapchainSupported)
 		{
@@ -192,39 +219,115 @@ static void ChoosePhysicalDevice(bool useIntegrated)
 	vkGetPhysicalDeviceProperties(Graphics.PhysicalDevice, &deviceProperties);
 	log_info("Using graphics device: %s\n", deviceProperties.deviceName);
 	free(devices);
+	
+	Graphics.PipelineCreationFeedback = CheckDeviceExtensionSupport(Graphics.PhysicalDevice, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+}
+
+// Prefers a family that can only transfer (a dma engine), then any family without graphics, then the graphics family
+static void ChooseTransferQueue()
+{
+	unsigned int queueFamilyCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(Graphics.PhysicalDevice, &queueFamilyCount, NULL);
+	VkQueueFamilyProperties * queueFamilies = malloc(queueFamilyCount * sizeof(VkQueueFamilyProperties));
+	vkGetPhysicalDeviceQueueFamilyProperties(Graphics.PhysicalDevice, &queueFamilyCount, queueFamilies);
+	
+	int dedicatedIndex = -1;
+	int separateIndex = -1;
+	for (int i = 0; i < queueFamilyCount; i++)
+	{
+		VkQueueFlags flags = queueFamilies[i].queueFlags;
+		if (queueFamilies[i].queueCount == 0 || flags & VK_QUEUE_GRAPHICS_BIT) { continue; }
+		// Compute queues can always transfer even if they don't report it
+		if (!(flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT))) { continue; }
+		if (!(flags & VK_QUEUE_COMPUTE_BIT) && dedicatedIndex == -1) { dedicatedIndex = i; }
+		if (separateIndex == -1) { separateIndex = i; }
+	}
+	free(queueFamilies);
+	
+	if (dedicatedIndex != -1) { Graphics.TransferQueueIndex = dedicatedIndex; }
+	else if (separateIndex != -1) { Graphics.TransferQueueIndex = separateIndex; }
+	else { Graphics.TransferQueueIndex = Graphics.GraphicsQueueIndex; }
+	if (Graphics.TransferQueueIndex == Graphics.GraphicsQueueIndex) { log_info("No separate transfer queue, uploads will use the graphics queue\n"); }
+}
+
+// Only the features needed by the bindless texture table are returned, Graphics.DescriptorIndexing is set if they're all supported
+static VkPhysicalDeviceDescriptorIndexingFeaturesEXT GetDescriptorIndexingFeatures(VkPhysicalDeviceProperties deviceProperties)
+{
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT enabled = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT };
+	Graphics.DescriptorIndexing = false;
+	Graphics.MaxBindlessTextures = 0;
+	if (deviceProperties.apiVersion < VK_API_VERSION_1_1 || !CheckDeviceExtensionSupport(Graphics.PhysicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) { return enabled; }
+	
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT };
+	VkPhysicalDeviceFeatures2 features = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &supported };
+	vkGetPhysicalDeviceFeatures2(Graphics.PhysicalDevice, &features);
+	if (!supported.runtimeDescriptorArray || !supported.descriptorBindingPartiallyBound ||
+		!supported.descriptorBindingSampledImageUpdateAfterBind || !supported.descriptorBindingUpdateUnusedWhilePending) { return enabled; }
+	
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT };
+	VkPhysicalDeviceProperties2 properties = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &indexingProperties };
+	vkGetPhysicalDeviceProperties2(Graphics.PhysicalDevice, &properties);
+	Graphics.MaxBindlessTextures = MIN(MIN(indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers),
+		MIN(indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages, indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers));
+	
+	Graphics.DescriptorIndexing = true;
+	enabled.runtimeDescriptorArray = VK_TRUE;
+	enabled.descriptorBindingPartiallyBound = VK_TRUE;
+	enabled.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	enabled.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	// Lets shaders index with values that differ between invocations (nonuniformEXT) instead of only push constants
+	enabled.shaderSampledImageArrayNonUniformIndexing = supported.shaderSampledImageArrayNonUniformIndexing;
+	return enabled;
 }
 
 static void CreateLogicalDevice()
 {
 	float queuePriority = 1.0f;
-	VkDeviceQueueCreateInfo graphicsQueueInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-		.queueFamilyIndex = Graphics.GraphicsQueueIndex,
-		.queueCount = 1,
-		.pQueuePriorities = &queuePriority,
-	};
-	VkDeviceQueueCreateInfo presentQueueInfo =
+	unsigned int queueFamilies[3] = { Graphics.GraphicsQueueIndex, Graphics.PresentQueueIndex, Graphics.TransferQueueIndex };
+	VkDeviceQueueCreateInfo queues[3];
+	int queueCount = 0;
+	for (int i = 0; i < 3; i++)
 	{
-		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-		.queueFamilyIndex = Graphics.PresentQueueIndex,
-		.queueCount = 1,
-		.pQueuePriorities = &queuePriority,
-	};
-	VkDeviceQueueCreateInfo queues[2] = { graphicsQueueInfo, presentQueueInfo };
+		bool duplicate = false;
+		for (int j = 0; j < queueCount; j++) { duplicate |= queues[j].queueFamilyIndex == queueFamilies[i]; }
+		if (duplicate) { continue; }
+		queues[queueCount++] = (VkDeviceQueueCreateInfo)
+		{
+			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.queueFamilyIndex = queueFamilies[i],
+			.queueCount = 1,
+			.pQueuePriorities = &queuePriority,
+		};
+	}
 	
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(Graphics.PhysicalDevice, &supportedFeatures);
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(Graphics.PhysicalDevice, &deviceProperties);
 	VkPhysicalDeviceFeatures deviceFeatures = { 0 };
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	Graphics.MultiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	Graphics.MaxDrawIndirectCount = Graphics.MultiDrawIndirect ? deviceProperties.limits.maxDrawIndirectCount : 1;
+	deviceFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	Graphics.TextureCompressionBC = supportedFeatures.textureCompressionBC;
+	Graphics.MaxSamplerAnisotropy = supportedFeatures.samplerAnisotropy ? deviceProperties.limits.maxSamplerAnisotropy : 1.0f;
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = GetDescriptorIndexingFeatures(deviceProperties);
 	
-	const char * extensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	const char * extensions[3];
+	unsigned int extensionCount = 0;
+	if (!Graphics.Headless) { extensions[extensionCount++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME; }
+	if (Graphics.PipelineCreationFeedback) { extensions[extensionCount++] = VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME; }
+	if (Graphics.DescriptorIndexing) { extensions[extensionCount++] = VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME; }
 	
-	int queueCount = Graphics.GraphicsQueueIndex == Graphics.PresentQueueIndex ? 1 : 2;
 	VkDeviceCreateInfo _DeviceInfo =
 	{
 		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.pNext = Graphics.DescriptorIndexing ? &indexingFeatures : NULL,
 		.queueCreateInfoCount = queueCount,
 		.pQueueCreateInfos = queues,
 		.pEnabledFeatures = &deviceFeatures,
-		.enabledExtensionCount = 1,
+		.enabledExtensionCount = extensionCount,
 		.ppEnabledExtensionNames = extensions,
 		.enabledLayerCount = 0,
 		.ppEnabledLayerNames = NULL,
@@ -239,6 +342,7 @@ static void CreateLogicalDevice()
 	
 	vkGetDeviceQueue(Graphics.Device, Graphics.GraphicsQueueIndex, 0, &Graphics.GraphicsQueue);
 	vkGetDeviceQueue(Graphics.Device, Graphics.PresentQueueIndex, 0, &Graphics.PresentQueue);
+	vkGetDeviceQueue(Graphics.Device, Graphics.TransferQueueIndex, 0, &Graphics.TransferQueue);
 }
 
 static void CreateSwapchain(int width, int height)
@@ -333,6 +437,22 @@ static void CreateSwapchain(int width, int height)
 	Window.Height = Graphics.Swapchain.Extent.height;
 }
 
+static void CreateHeadlessSwapchain(int width, int height)
+{
+	// There are no images to present, only the format and extent are used by framebuffers and pipelines
+	Graphics.Swapchain = (struct GraphicsSwapchain)
+	{
+		.Instance = VK_NULL_HANDLE,
+		.Extent = { width, height },
+		.ColorFormat = VK_FORMAT_B8G8R8A8_UNORM,
+		.ImageCount = 0,
+		.Images = NULL,
+		.CurrentImageIndex = 0,
+	};
+	Window.Width = width;
+	Window.Height = height;
+}
+
 static void GetSwapchainImages()
 {
 	vkGetSwapchainImagesKHR(Graphics.Device, Graphics.Swapchain.Instance, &Graphics.Swapchain.ImageCount, NULL);
@@ -387,6 +507,7 @@ static void GetSwapchainImages()
 		.pCommandBuffers = &commandBuffer,
 	};
 	vkQueueSubmit(Graphics.GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	SDL_AtomicAdd(&Graphics.Statistics.QueueSubmits, 1);
 	vkDeviceWaitIdle(Graphics.Device);
 	
 	vkFreeCommandBuffers(Graphics.Device, Graphics.CommandPool, 1, &commandBuffer);
@@ -436,6 +557,18 @@ static void CreateRenderPass()
 		.pDepthStencilAttachment = &depthAttachmentReference,
 	};
 	
+	// A frame can begin the render pass several times on the same attachments, switching between inline commands and record jobs ends
+	// one instance and begins the next. The attachment writes of an instance have to finish before the next one loads them
+	VkSubpassDependency dependency =
+	{
+		.srcSubpass = VK_SUBPASS_EXTERNAL,
+		.dstSubpass = 0,
+		.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+	};
+	
 	VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment };
 	VkRenderPassCreateInfo renderPassInfo =
 	{
@@ -444,8 +577,8 @@ static void CreateRenderPass()
 		.pAttachments = attachments,
 		.subpassCount = 1,
 		.pSubpasses = &subpass,
-		.dependencyCount = 0,
-		.pDependencies = NULL,
+		.dependencyCount = 1,
+		.pDependencies = &dependency,
 	};
 	VkResult result = vkCreateRenderPass(Graphics.Device, &renderPassInfo, NULL, &Graphics.RenderPass);
 	if (result != VK_SUCCESS)
@@ -489,13 +622,94 @@ static void CreateAllocator()
 	}
 }
 
-static void CreateCompiler()
+static void CreateCompiler(const char * cachePath)
 {
 	Graphics.ShaderCompiler = shaderc_compiler_initialize();
+	Graphics.ShaderCachePath = cachePath;
+	if (cachePath != NULL && !FileCreateDirectory(cachePath))
+	{
+		log_warn("Unable to create the shader cache directory %s\n", cachePath);
+		Graphics.ShaderCachePath = NULL;
+	}
 }
 
-static void CreateFrameResources()
+static bool ValidatePipelineCache(unsigned long size, const unsigned char * data)
 {
+	uint32_t header[4];
+	if (size < sizeof(header) + VK_UUID_SIZE) { return false; }
+	memcpy(header, data, sizeof(header));
+	
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(Graphics.PhysicalDevice, &deviceProperties);
+	if (header[0] < sizeof(header) + VK_UUID_SIZE || header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) { return false; }
+	if (header[2] != deviceProperties.vendorID || header[3] != deviceProperties.deviceID) { return false; }
+	return memcmp(data + sizeof(header), deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+static void CreatePipelineCache(const char * path)
+{
+	Graphics.PipelineCachePath = path;
+	unsigned long size = 0;
+	void * data = NULL;
+	File file = path == NULL ? NULL : FileTryOpen(path, FileModeReadBinary);
+	if (file != NULL)
+	{
+		size = FileGetSize(file);
+		data = malloc(size);
+		FileRead(file, 0, size, data);
+		FileClose(file);
+		if (!ValidatePipelineCache(size, data))
+		{
+			log_warn("Pipeline cache %s doesn't match the current device, it will be rebuilt\n", path);
+			size = 0;
+		}
+	}
+	
+	VkPipelineCacheCreateInfo createInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = size,
+		.pInitialData = size > 0 ? data : NULL,
+	};
+	VkResult result = vkCreatePipelineCache(Graphics.Device, &createInfo, NULL, &Graphics.PipelineCache);
+	if (result != VK_SUCCESS && size > 0)
+	{
+		log_warn("Failed to load the pipeline cache: %i\n", result);
+		createInfo.initialDataSize = 0;
+		createInfo.pInitialData = NULL;
+		result = vkCreatePipelineCache(Graphics.Device, &createInfo, NULL, &Graphics.PipelineCache);
+	}
+	if (result != VK_SUCCESS)
+	{
+		log_fatal("Failed to create pipeline cache: %i\n", result);
+		exit(1);
+	}
+	free(data);
+}
+
+static void DestroyPipelineCache()
+{
+	if (Graphics.PipelineCachePath != NULL)
+	{
+		size_t size;
+		vkGetPipelineCacheData(Graphics.Device, Graphics.PipelineCache, &size, NULL);
+		void * data = malloc(size);
+		vkGetPipelineCacheData(Graphics.Device, Graphics.PipelineCache, &size, data);
+		File file = FileTryOpen(Graphics.PipelineCachePath, FileModeWriteBinary);
+		if (file != NULL)
+		{
+			FileWrite(file, 0, size, data);
+			FileClose(file);
+		}
+		else { log_warn("Unable to write the pipeline cache to %s\n", Graphics.PipelineCachePath); }
+		free(data);
+	}
+	vkDestroyPipelineCache(Graphics.Device, Graphics.PipelineCache, NULL);
+}
+
+static void CreateFrameResources(int arenaSize)
+{
+	if (arenaSize <= 0) { arenaSize = 64 * 1024; }
 	Graphics.FrameResources = malloc(Graphics.FrameResourceCount * sizeof(*Graphics.FrameResources));
 	for (int i = 0; i < Graphics.FrameResourceCount; i++)
 	{
@@ -522,30 +736,593 @@ static void CreateFrameResources()
 		};
 		vkCreateFence(Graphics.Device, &fenceInfo, NULL, &Graphics.FrameResources[i].FrameReady);
 		
-		Graphics.FrameResources[i].DestroyVertexBufferQueue = ListCreate();
-		Graphics.FrameResources[i].DestroyTextureQueue = ListCreate();
-		Graphics.FrameResources[i].DestroyPipelineQueue = ListCreate();
-		Graphics.FrameResources[i].DestroyFrameBufferQueue = ListCreate();
-		Graphics.FrameResources[i].DestroyUniformBufferQueue = ListCreate();
-		Graphics.FrameResources[i].UpdateDescriptorQueue = ListCreate();
+		Graphics.FrameResources[i].DescriptorWriteCount = 0;
+		Graphics.FrameResources[i].DescriptorWriteCapacity = 16;
+		Graphics.FrameResources[i].DescriptorWrites = malloc(16 * sizeof(struct GraphicsDescriptorWrite));
+		Graphics.FrameResources[i].Arena = (struct GraphicsFrameArena)
+		{
+			.Data = malloc(arenaSize),
+			.Capacity = arenaSize,
+			.Offset = 0,
+			.Overflow = 0,
+			.OverflowBlocks = ListCreate(),
+		};
 	}
 	Graphics.FrameIndex = 0;
-	Graphics.PreRenderSemaphores = ListCreate();
+	SDL_AtomicSet(&Graphics.FrameNumber, 0);
+	Graphics.CompletedFrame = 0;
+	Graphics.RenderThread = SDL_ThreadID();
+}
+
+static void CreateUniformRing(struct GraphicsUniformRing * ring, unsigned int size)
+{
+	VkBufferCreateInfo bufferInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = size,
+		.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+	};
+	VmaAllocationCreateInfo allocationInfo =
+	{
+		.usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+		.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+	};
+	VmaAllocationInfo info;
+	VkResult result = vmaCreateBuffer(Graphics.Allocator, &bufferInfo, &allocationInfo, &ring->Buffer, &ring->Allocation, &info);
+	if (result != VK_SUCCESS)
+	{
+		log_fatal("Failed to create the uniform ring: %i\n", result);
+		exit(1);
+	}
+	ring->Data = info.pMappedData;
+	ring->Capacity = size;
+	ring->Offset = 0;
+	ring->Lock = 0;
+	ring->Overflow = NULL;
+}
+
+static void CreateUniformRings(int size)
+{
+	if (size <= 0) { size = 4 * 1024 * 1024; }
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(Graphics.PhysicalDevice, &properties);
+	Graphics.UniformAlignment = MAX(properties.limits.minUniformBufferOffsetAlignment, 16);
+	for (int i = 0; i < Graphics.FrameResourceCount; i++) { CreateUniformRing(&Graphics.FrameResources[i].UniformRing, size); }
+}
+
+// A frame that overflowed its uniform ring gets a bigger one the next time its frame resource is acquired, big enough for the ring and its overflow block.
+// The old ring can only be destroyed once the frame's fence has been waited on, and every descriptor that viewed it is written again
+static void GrowUniformRing(int frameResource)
+{
+	struct GraphicsUniformRing * ring = &Graphics.FrameResources[frameResource].UniformRing;
+	unsigned int size = MAX(ring->Capacity * 2, ring->Capacity + ring->Overflow->Offset);
+	log_warn("Growing the uniform ring from %u to %u bytes, increase GraphicsConfigure.UniformRingSize to avoid this\n", ring->Capacity, size);
+	vmaDestroyBuffer(Graphics.Allocator, ring->Overflow->Buffer, ring->Overflow->Allocation);
+	free(ring->Overflow);
+	vmaDestroyBuffer(Graphics.Allocator, ring->Buffer, ring->Allocation);
+	CreateUniformRing(ring, size);
+	PipelineRewriteUniforms(frameResource);
+}
+
+// Copies data into a uniform ring or overflow block, the lock of the frame's ring must be held.
+// Offset keeps counting past the end when it's full so the frame knows how much it needed, returns false if the data didn't fit
+static bool AllocateUniform(struct GraphicsUniformRing * ring, const void * data, unsigned int size, unsigned int * offset)
+{
+	unsigned int start = (ring->Offset + Graphics.UniformAlignment - 1) / Graphics.UniformAlignment * Graphics.UniformAlignment;
+	ring->Offset = start + size;
+	if (ring->Offset > ring->Capacity) { return false; }
+	memcpy(ring->Data + start, data, size);
+	*offset = start;
+	return true;
+}
+
+// Copies data into the overflow block of the frame's ring, creating it the first time the ring fills up.
+// The block can't be replaced while the frame is recording either, so when it's full too the draw has nothing to bind
+static bool AllocateOverflowUniform(struct GraphicsUniformRing * ring, const void * data, unsigned int size, unsigned int * offset)
+{
+	if (ring->Overflow == NULL)
+	{
+		log_warn("The uniform ring is full, the rest of the frame's uniforms go to an overflow block\n");
+		ring->Overflow = malloc(sizeof(struct GraphicsUniformRing));
+		CreateUniformRing(ring->Overflow, MAX(ring->Capacity, size));
+	}
+	bool full = ring->Overflow->Offset > ring->Overflow->Capacity;
+	if (AllocateUniform(ring->Overflow, data, size, offset)) { return true; }
+	if (!full) { log_warn("The uniform ring's overflow block is full, draws will be skipped this frame\n"); }
+	return false;
+}
+
+// Copies a uniform buffer into the uniform ring, or its overflow block, the first time the frame draws with its current data and gives its offset.
+// Record jobs can race to upload the same buffer, the offset is written before the frame and version that mark it as uploaded.
+// Returns false if the data didn't fit
+static bool UploadUniform(UniformBuffer uniform, int frameNumber, bool overflow, unsigned int * offset)
+{
+	unsigned int * uploadedVersion = overflow ? &uniform->OverflowVersion : &uniform->UploadedVersion;
+	int * uploadedFrame = overflow ? &uniform->OverflowFrame : &uniform->UploadedFrame;
+	unsigned int * uploadedOffset = overflow ? &uniform->OverflowOffset : &uniform->UploadedOffset;
+	if (*uploadedFrame == frameNumber && *uploadedVersion == uniform->Version)
+	{
+		SDL_MemoryBarrierAcquire();
+		*offset = *uploadedOffset;
+		return true;
+	}
+	struct GraphicsUniformRing * ring = &Graphics.FrameResources[Graphics.FrameIndex].UniformRing;
+	SDL_AtomicLock(&ring->Lock);
+	bool uploaded = *uploadedFrame == frameNumber && *uploadedVersion == uniform->Version;
+	if (!uploaded)
+	{
+		unsigned int start;
+		if (overflow) { uploaded = AllocateOverflowUniform(ring, uniform->Data, uniform->Size, &start); }
+		else { uploaded = AllocateUniform(ring, uniform->Data, uniform->Size, &start); }
+		if (uploaded)
+		{
+			*uploadedOffset = start;
+			SDL_MemoryBarrierRelease();
+			*uploadedFrame = frameNumber;
+			*uploadedVersion = uniform->Version;
+		}
+	}
+	*offset = *uploadedOffset;
+	SDL_AtomicUnlock(&ring->Lock);
+	return uploaded;
+}
+
+static void CreateRecorders()
+{
+	Graphics.Recorder = (struct GraphicsRecorder){ .Statistics = &Graphics.Statistics };
+	Graphics.RecorderKey = SDL_TLSCreate();
+	for (int i = 0; i < Graphics.FrameResourceCount; i++)
+	{
+		Graphics.FrameResources[i].RecordSlots = NULL;
+		Graphics.FrameResources[i].RecordSlotCount = 0;
+		Graphics.FrameResources[i].RecordSlotsUsed = 0;
+	}
+}
+
+// A job of GraphicsRecordParallel and the state of the secondary command buffer it records into
+struct RecordJob
+{
+	GraphicsRecordJob Job;
+	/// The job system's storage for the job, it lives in the frame arena so that submitting doesn't allocate
+	struct Job Work;
+	struct GraphicsRecordSlot * Slot;
+	struct GraphicsRecorder Recorder;
+	struct GraphicsStatistics Statistics;
+};
+
+// Takes the next count slots of the frame resource, creating the ones it hasn't used before
+static struct GraphicsRecordSlot * AcquireRecordSlots(int frameResource, int count)
+{
+	struct GraphicsFrameResource * resource = &Graphics.FrameResources[frameResource];
+	if (resource->RecordSlotsUsed + count > resource->RecordSlotCount)
+	{
+		int slotCount = resource->RecordSlotsUsed + count;
+		resource->RecordSlots = realloc(resource->RecordSlots, slotCount * sizeof(struct GraphicsRecordSlot));
+		for (int i = resource->RecordSlotCount; i < slotCount; i++)
+		{
+			struct GraphicsRecordSlot * slot = resource->RecordSlots + i;
+			*slot = (struct GraphicsRecordSlot){ 0 };
+			VkCommandPoolCreateInfo createInfo =
+			{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+				.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+				.queueFamilyIndex = Graphics.GraphicsQueueIndex,
+			};
+			VkResult result = vkCreateCommandPool(Graphics.Device, &createInfo, NULL, &slot->CommandPool);
+			if (result != VK_SUCCESS)
+			{
+				log_fatal("Failed to create a record command pool: %i\n", result);
+				exit(1);
+			}
+			VkCommandBufferAllocateInfo allocateInfo =
+			{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+				.commandPool = slot->CommandPool,
+				.commandBufferCount = 1,
+			};
+			vkAllocateCommandBuffers(Graphics.Device, &allocateInfo, &slot->CommandBuffer);
+		}
+		resource->RecordSlotCount = slotCount;
+	}
+	struct GraphicsRecordSlot * slots = resource->RecordSlots + resource->RecordSlotsUsed;
+	resource->RecordSlotsUsed += count;
+	return slots;
+}
+
+// Resetting the pools resets every secondary command buffer the frame resource recorded
+static void ResetRecordSlots(int frameResource)
+{
+	struct GraphicsFrameResource * resource = &Graphics.FrameResources[frameResource];
+	for (int i = 0; i < resource->RecordSlotsUsed; i++)
+	{
+		vkResetCommandPool(Graphics.Device, resource->RecordSlots[i].CommandPool, 0);
+	}
+	resource->RecordSlotsUsed = 0;
+}
+
+static void DestroyRecorders()
+{
+	for (int i = 0; i < Graphics.FrameResourceCount; i++)
+	{
+		struct GraphicsFrameResource * resource = &Graphics.FrameResources[i];
+		for (int j = 0; j < resource->RecordSlotCount; j++)
+		{
+			vkDestroyCommandPool(Graphics.Device, resource->RecordSlots[j].CommandPool, NULL);
+			free(resource->RecordSlots[j].DynamicOffsets);
+			free(resource->RecordSlots[j].PushConstantData);
+		}
+		free(resource->RecordSlots);
+	}
+	free(Graphics.Recorder.Bound.PushConstantData);
+	free(Graphics.Recorder.DynamicOffsets);
+}
+
+static void CreateDestroyQueue(int capacity)
+{
+	if (capacity <= 0) { capacity = 4096; }
+	unsigned int powerOfTwo = 1;
+	while (powerOfTwo < capacity) { powerOfTwo *= 2; }
+	
+	Graphics.DestroyQueue.Capacity = powerOfTwo;
+	Graphics.DestroyQueue.Entries = malloc(powerOfTwo * sizeof(struct GraphicsDestroyEntry));
+	for (unsigned int i = 0; i < powerOfTwo; i++)
+	{
+		SDL_AtomicSet(&Graphics.DestroyQueue.Entries[i].Sequence, (int)i);
+	}
+	SDL_AtomicSet(&Graphics.DestroyQueue.Tail, 0);
+	Graphics.DestroyQueue.Head = 0;
+	Graphics.DestroyQueue.Overflow = ListCreate();
+	Graphics.DestroyQueue.OverflowLock = 0;
+}
+
+#define ProfileSampleCount 64
+#define ProfileTraceFrames 256
+
+struct ProfileScope
+{
+	const char * Name;
+	double Samples[ProfileSampleCount];
+	int SampleCount;
+	int NextSample;
+};
+
+static void CreateProfiler(int scopeCount)
+{
+	Graphics.Profiler = (struct GraphicsProfiler){ 0 };
+	for (int i = 0; i < Graphics.FrameResourceCount; i++)
+	{
+		Graphics.FrameResources[i].QueryPool = VK_NULL_HANDLE;
+		Graphics.FrameResources[i].ProfileQueries = NULL;
+		Graphics.FrameResources[i].ProfileQueryCount = 0;
+	}
+	if (scopeCount <= 0) { return; }
+	
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(Graphics.PhysicalDevice, &properties);
+	unsigned int queueFamilyCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(Graphics.PhysicalDevice, &queueFamilyCount, NULL);
+	VkQueueFamilyProperties * queueFamilies = malloc(queueFamilyCount * sizeof(VkQueueFamilyProperties));
+	vkGetPhysicalDeviceQueueFamilyProperties(Graphics.PhysicalDevice, &queueFamilyCount, queueFamilies);
+	unsigned int validBits = queueFamilies[Graphics.GraphicsQueueIndex].timestampValidBits;
+	free(queueFamilies);
+	if (validBits == 0)
+	{
+		log_warn("The graphics queue doesn't support timestamps, gpu profiling is disabled\n");
+		return;
+	}
+	
+	// One scope is reserved for timing the whole frame
+	scopeCount++;
+	Graphics.Profiler.Enabled = true;
+	Graphics.Profiler.Capacity = scopeCount;
+	Graphics.Profiler.TimestampPeriod = properties.limits.timestampPeriod;
+	Graphics.Profiler.TimestampMask = validBits >= 64 ? ~0ULL : (1ULL << validBits) - 1;
+	Graphics.Profiler.Scopes = ListCreate();
+	Graphics.Profiler.TraceCapacity = scopeCount * ProfileTraceFrames;
+	Graphics.Profiler.Trace = malloc(Graphics.Profiler.TraceCapacity * sizeof(struct GraphicsProfileEvent));
+	for (int i = 0; i < Graphics.FrameResourceCount; i++)
+	{
+		VkQueryPoolCreateInfo queryPoolInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = scopeCount * 2,
+		};
+		VkResult result = vkCreateQueryPool(Graphics.Device, &queryPoolInfo, NULL, &Graphics.FrameResources[i].QueryPool);
+		if (result != VK_SUCCESS)
+		{
+			log_fatal("Failed to create timestamp query pool: %i\n", result);
+			exit(1);
+		}
+		Graphics.FrameResources[i].ProfileQueries = malloc(scopeCount * sizeof(struct GraphicsProfileQuery));
+	}
+}
+
+static void DestroyProfiler()
+{
+	if (!Graphics.Profiler.Enabled) { return; }
+	for (int i = 0; i < Graphics.FrameResourceCount; i++)
+	{
+		vkDestroyQueryPool(Graphics.Device, Graphics.FrameResources[i].QueryPool, NULL);
+		free(Graphics.FrameResources[i].ProfileQueries);
+	}
+	for (int i = 0; i < ListGetCount(Graphics.Profiler.Scopes); i++) { free(ListGetValue(Graphics.Profiler.Scopes, i)); }
+	ListDestroy(Graphics.Profiler.Scopes);
+	free(Graphics.Profiler.Trace);
+}
+
+static struct ProfileScope * FindProfileScope(const char * name)
+{
+	for (int i = 0; i < ListGetCount(Graphics.Profiler.Scopes); i++)
+	{
+		struct ProfileScope * scope = ListGetValue(Graphics.Profiler.Scopes, i);
+		if (scope->Name == name || strcmp(scope->Name, name) == 0) { return scope; }
+	}
+	struct ProfileScope * scope = malloc(sizeof(struct ProfileScope));
+	*scope = (struct ProfileScope){ .Name = name };
+	ListPush(Graphics.Profiler.Scopes, scope);
+	return scope;
+}
+
+// Only called once the frame resource's fence has signaled, so the results are available without waiting
+static void ReadProfileQueries(int frameResource)
+{
+	struct GraphicsFrameResource * frame = Graphics.FrameResources + frameResource;
+	int count = frame->ProfileQueryCount;
+	frame->ProfileQueryCount = 0;
+	if (count == 0) { return; }
+	
+	unsigned long long * timestamps = GraphicsFrameAllocate(frameResource, count * 2 * sizeof(unsigned long long));
+	VkResult result = vkGetQueryPoolResults(Graphics.Device, frame->QueryPool, 0, count * 2, count * 2 * sizeof(unsigned long long), timestamps, sizeof(unsigned long long), VK_QUERY_RESULT_64_BIT);
+	INSTRUMENT_VULKAN_CALLS(1);
+	if (result != VK_SUCCESS) { return; }
+	
+	struct GraphicsProfiler * profiler = &Graphics.Profiler;
+	if (profiler->TimeBase == 0) { profiler->TimeBase = timestamps[0] & profiler->TimestampMask; }
+	for (int i = 0; i < count; i++)
+	{
+		unsigned long long begin = timestamps[i * 2] & profiler->TimestampMask;
+		unsigned long long end = timestamps[i * 2 + 1] & profiler->TimestampMask;
+		double duration = ((end - begin) & profiler->TimestampMask) * profiler->TimestampPeriod / 1000000.0;
+		
+		struct ProfileScope * scope = FindProfileScope(frame->ProfileQueries[i].Name);
+		scope->Samples[scope->NextSample] = duration;
+		scope->NextSample = (scope->NextSample + 1) % ProfileSampleCount;
+		if (scope->SampleCount < ProfileSampleCount) { scope->SampleCount++; }
+		
+		profiler->Trace[profiler->TraceNext] = (struct GraphicsProfileEvent)
+		{
+			.Name = frame->ProfileQueries[i].Name,
+			.Depth = frame->ProfileQueries[i].Depth,
+			.Start = ((begin - profiler->TimeBase) & profiler->TimestampMask) * profiler->TimestampPeriod / 1000000.0,
+			.Duration = duration,
+		};
+		profiler->TraceNext = (profiler->TraceNext + 1) % profiler->TraceCapacity;
+		if (profiler->TraceCount < profiler->TraceCapacity) { profiler->TraceCount++; }
+	}
+}
+
+static void DestroyObject(GraphicsDestroyType type, void * object)
+{
+	switch (type)
+	{
+		case GraphicsDestroyTypeVertexBuffer: VertexBufferDestroy(object); break;
+		case GraphicsDestroyTypeUniformBuffer: UniformBufferDestroy(object); break;
+		case GraphicsDestroyTypeFrameBuffer: FrameBufferDestroy(object); break;
+		case GraphicsDestroyTypePipeline: PipelineDestroyQueued(object); break;
+		case GraphicsDestroyTypeTexture: TextureDestroy(object); break;
+		case GraphicsDestroyTypeIndexBuffer: IndexBufferDestroy(object); break;
+		case GraphicsDestroyTypeIndirectBuffer: IndirectBufferDestroy(object); break;
+	}
+}
+
+// Only the render thread consumes the queue, any thread can produce into it
+static void DestroyQueuedObjects(bool all)
+{
+	struct GraphicsDestroyQueue * queue = &Graphics.DestroyQueue;
+	while (true)
+	{
+		struct GraphicsDestroyEntry * entry = queue->Entries + (queue->Head & (queue->Capacity - 1));
+		if ((unsigned int)SDL_AtomicGet(&entry->Sequence) != queue->Head + 1) { break; }
+		if (!all && (int)((unsigned int)entry->Frame - (unsigned int)Graphics.CompletedFrame) > 0) { break; }
+		DestroyObject(entry->Type, entry->Object);
+		SDL_AtomicSet(&entry->Sequence, (int)(queue->Head + queue->Capacity));
+		queue->Head++;
+	}
+	
+	// Overflow entries are taken out one at a time so that the lock isn't held while destroying
+	while (true)
+	{
+		struct GraphicsDestroyEntry * entry = NULL;
+		SDL_AtomicLock(&queue->OverflowLock);
+		for (int i = 0; i < ListGetCount(queue->Overflow); i++)
+		{
+			struct GraphicsDestroyEntry * overflow = ListGetValue(queue->Overflow, i);
+			if (all || (int)((unsigned int)overflow->Frame - (unsigned int)Graphics.CompletedFrame) <= 0)
+			{
+				entry = overflow;
+				ListOutsert(queue->Overflow, i);
+				break;
+			}
+		}
+		SDL_AtomicUnlock(&queue->OverflowLock);
+		if (entry == NULL) { break; }
+		DestroyObject(entry->Type, entry->Object);
+		free(entry);
+	}
+}
+
+void * GraphicsFrameAllocate(int frameResource, size_t size)
+{
+	struct GraphicsFrameArena * arena = &Graphics.FrameResources[frameResource].Arena;
+	size = (size + 15) & ~(size_t)15;
+	if (arena->Offset + size <= arena->Capacity)
+	{
+		void * data = arena->Data + arena->Offset;
+		arena->Offset += size;
+		return data;
+	}
+	// Fall back to the heap for this frame and grow the arena when it's reset
+	Graphics.Statistics.FrameArenaOverflows++;
+	arena->Overflow += size;
+	void * data = malloc(size);
+	ListPush(arena->OverflowBlocks, data);
+	return data;
+}
+
+static void ResetFrameArena(struct GraphicsFrameArena * arena)
+{
+	if (arena->Overflow > 0)
+	{
+		for (int i = 0; i < ListGetCount(arena->OverflowBlocks); i++) { free(ListGetValue(arena->OverflowBlocks, i)); }
+		ListClear(arena->OverflowBlocks);
+		arena->Capacity = (arena->Capacity + arena->Overflow) * 2;
+		free(arena->Data);
+		arena->Data = malloc(arena->Capacity);
+		arena->Overflow = 0;
+	}
+	arena->Offset = 0;
+}
+
+void GraphicsQueueDescriptorWrite(int frameResource, struct GraphicsDescriptorWrite write)
+{
+	struct GraphicsFrameResource * frame = Graphics.FrameResources + frameResource;
+	if (frame->DescriptorWriteCount == frame->DescriptorWriteCapacity)
+	{
+		frame->DescriptorWriteCapacity *= 2;
+		frame->DescriptorWrites = realloc(frame->DescriptorWrites, frame->DescriptorWriteCapacity * sizeof(struct GraphicsDescriptorWrite));
+	}
+	write.Order = frame->DescriptorWriteCount;
+	frame->DescriptorWrites[frame->DescriptorWriteCount++] = write;
+}
+
+static int CompareDescriptorWrites(const void * a, const void * b)
+{
+	const struct GraphicsDescriptorWrite * writeA = a;
+	const struct GraphicsDescriptorWrite * writeB = b;
+	int set = memcmp(&writeA->Set, &writeB->Set, sizeof(VkDescriptorSet));
+	if (set != 0) { return set; }
+	if (writeA->Binding != writeB->Binding) { return writeA->Binding < writeB->Binding ? -1 : 1; }
+	if (writeA->ArrayElement != writeB->ArrayElement) { return writeA->ArrayElement < writeB->ArrayElement ? -1 : 1; }
+	return writeA->Order < writeB->Order ? -1 : 1;
+}
+
+static bool SameDescriptor(const struct GraphicsDescriptorWrite * a, const struct GraphicsDescriptorWrite * b)
+{
+	return a->Set == b->Set && a->Binding == b->Binding && a->ArrayElement == b->ArrayElement;
+}
+
+static void UpdateDescriptorSets(int frameResource)
+{
+	struct GraphicsFrameResource * frame = Graphics.FrameResources + frameResource;
+	int count = frame->DescriptorWriteCount;
+	if (count == 0) { return; }
+	
+	// Sorting groups the writes to each descriptor together in the order they were queued
+	qsort(frame->DescriptorWrites, count, sizeof(struct GraphicsDescriptorWrite), CompareDescriptorWrites);
+	VkWriteDescriptorSet * writes = GraphicsFrameAllocate(frameResource, count * sizeof(VkWriteDescriptorSet));
+	VkDescriptorBufferInfo * bufferInfos = GraphicsFrameAllocate(frameResource, count * sizeof(VkDescriptorBufferInfo));
+	VkDescriptorImageInfo * imageInfos = GraphicsFrameAllocate(frameResource, count * sizeof(VkDescriptorImageInfo));
+	int writeCount = 0, bufferCount = 0, imageCount = 0;
+	struct GraphicsDescriptorWrite * previous = NULL;
+	for (int i = 0; i < count; i++)
+	{
+		struct GraphicsDescriptorWrite * write = frame->DescriptorWrites + i;
+		// Only the last write to a descriptor matters
+		if (i + 1 < count && SameDescriptor(write, write + 1)) { continue; }
+		
+		bool image = write->Type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		if (image) { imageInfos[imageCount++] = write->Info.Image; }
+		else { bufferInfos[bufferCount++] = write->Info.Buffer; }
+		
+		// Consecutive array elements of one binding become a single write
+		if (previous != NULL && previous->Set == write->Set && previous->Binding == write->Binding &&
+			previous->Type == write->Type && previous->ArrayElement + 1 == write->ArrayElement)
+		{
+			writes[writeCount - 1].descriptorCount++;
+		}
+		else
+		{
+			writes[writeCount++] = (VkWriteDescriptorSet)
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.descriptorCount = 1,
+				.descriptorType = write->Type,
+				.dstArrayElement = write->ArrayElement,
+				.dstBinding = write->Binding,
+				.dstSet = write->Set,
+				.pImageInfo = image ? imageInfos + imageCount - 1 : NULL,
+				.pBufferInfo = image ? NULL : bufferInfos + bufferCount - 1,
+			};
+		}
+		previous = write;
+	}
+	vkUpdateDescriptorSets(Graphics.Device, writeCount, writes, 0, NULL);
+	INSTRUMENT_VULKAN_CALLS(1);
+	Graphics.Statistics.DescriptorWritesCoalesced += count - writeCount;
+	frame->DescriptorWriteCount = 0;
+}
+
+void GraphicsQueueDestroy(GraphicsDestroyType type, void * object)
+{
+	struct GraphicsDestroyQueue * queue = &Graphics.DestroyQueue;
+	unsigned int position = SDL_AtomicGet(&queue->Tail);
+	struct GraphicsDestroyEntry * entry;
+	while (true)
+	{
+		entry = queue->Entries + (position & (queue->Capacity - 1));
+		int difference = (int)((unsigned int)SDL_AtomicGet(&entry->Sequence) - position);
+		if (difference == 0)
+		{
+			if (SDL_AtomicCAS(&queue->Tail, (int)position, (int)(position + 1))) { break; }
+		}
+		else if (difference < 0)
+		{
+			// The ring is full, waiting can't make room when every entry belongs to the frame being recorded so the entry spills into a list
+			struct GraphicsDestroyEntry * overflow = malloc(sizeof(struct GraphicsDestroyEntry));
+			overflow->Type = type;
+			overflow->Object = object;
+			overflow->Frame = SDL_AtomicGet(&Graphics.FrameNumber);
+			SDL_AtomicLock(&queue->OverflowLock);
+			if (ListGetCount(queue->Overflow) == 0) { log_warn("The destroy queue is full, consider increasing GraphicsConfigure.DestroyQueueCapacity\n"); }
+			ListPush(queue->Overflow, overflow);
+			SDL_AtomicUnlock(&queue->OverflowLock);
+			return;
+		}
+		position = SDL_AtomicGet(&queue->Tail);
+	}
+	entry->Type = type;
+	entry->Object = object;
+	entry->Frame = SDL_AtomicGet(&Graphics.FrameNumber);
+	SDL_AtomicSet(&entry->Sequence, (int)(position + 1));
 }
 
 void GraphicsInitialize(GraphicsConfigure config)
 {
 	log_info("Initializing the graphics backend...\n");
 	Graphics.FrameResourceCount = config.FrameResourceCount;
+	Graphics.Headless = config.Headless;
+	if (Graphics.Headless) { log_info("Running headless, there will be no surface or swapchain\n"); }
 	CheckExtensionSupport();
 	CreateInstance(config.VulkanValidation);
 	CreateSurface();
 	ChoosePhysicalDevice(config.TargetIntegratedDevice);
+	ChooseTransferQueue();
 	CreateLogicalDevice();
 	CreateCommandPool();
 	CreateAllocator();
-	CreateCompiler();
-	CreateFrameResources();
+	TransferInitialize(config.StagingRingSize);
+	BindlessInitialize(config.BindlessTextureCount);
+	PipelineInitialize();
+	CreatePipelineCache(config.PipelineCachePath);
+	CreateCompiler(config.ShaderCachePath);
+	CreateFrameResources(config.FrameArenaSize);
+	CreateUniformRings(config.UniformRingSize);
+	CreateRecorders();
+	CreateDestroyQueue(config.DestroyQueueCapacity);
+	CreateProfiler(config.ProfileScopeCount);
 	GraphicsCreateSwapchain(Window.Width, Window.Height);
 	log_info("Successfully initialized the graphics backend.\n");
 }
@@ -553,40 +1330,66 @@ void GraphicsInitialize(GraphicsConfigure config)
 void GraphicsCreateSwapchain(int width, int height)
 {
 	log_info("Creating the swapchain...");
-	CreateSwapchain(width, height);
-	GetSwapchainImages();
+	if (Graphics.Headless) { CreateHeadlessSwapchain(width, height); }
+	else
+	{
+		CreateSwapchain(width, height);
+		GetSwapchainImages();
+	}
 	CreateRenderPass();
 	log_info("Successfully created the swapchain\n");
 }
 
+// Nothing is bound in a new command buffer
+static void ResetBoundState(struct GraphicsRecorder * recorder)
+{
+	recorder->BoundPipeline = NULL;
+	recorder->DescriptorBindSkipped = false;
+	recorder->Bound.Pipeline = VK_NULL_HANDLE;
+	recorder->Bound.DynamicStateSet = false;
+	recorder->Bound.PushConstantRange = (VkPushConstantRange){ 0 };
+}
+
 void GraphicsAquireNextImage()
 {
 	Graphics.FrameIndex = (Graphics.FrameIndex + 1) % Graphics.FrameResourceCount;
 	unsigned int i = Graphics.FrameIndex;
+	int frameNumber = SDL_AtomicAdd(&Graphics.FrameNumber, 1) + 1;
+	INSTRUMENT_BEGIN("GraphicsAquireNextImage");
+	INSTRUMENT_BEGIN("FenceWait");
 	vkWaitForFences(Graphics.Device, 1, &Graphics.FrameResources[i].FrameReady, VK_TRUE, UINT64_MAX);
 	vkResetFences(Graphics.Device, 1, &Graphics.FrameResources[i].FrameReady);
+	INSTRUMENT_VULKAN_CALLS(2);
+	INSTRUMENT_END();
+	// The frame resource was last used by the frame FrameResourceCount frames ago
+	Graphics.CompletedFrame = frameNumber - Graphics.FrameResourceCount;
 	
-	for (int j = 0; j < Graphics.FrameResources[i].DestroyVertexBufferQueue->Count; j++)
-	{
-		VertexBuffer vertexBuffer = ListGetValue(Graphics.FrameResources[i].DestroyVertexBufferQueue, j);
-		VertexBufferDestroy(vertexBuffer);
-	}
-	ListClear(Graphics.FrameResources[i].DestroyVertexBufferQueue);
-	for (int j = 0; j < Graphics.FrameResources[i].UpdateDescriptorQueue->Count; j++)
-	{
-		VkWriteDescriptorSet * writeInfo = ListGetValue(Graphics.FrameResources[i].UpdateDescriptorQueue, j);
-		vkUpdateDescriptorSets(Graphics.Device, 1, writeInfo, 0, NULL);
-		free((void *)writeInfo->pBufferInfo);
-		free(writeInfo);
-	}
-	ListClear(Graphics.FrameResources[i].UpdateDescriptorQueue);
+	INSTRUMENT_BEGIN("DestroyDrain");
+	DestroyQueuedObjects(false);
+	INSTRUMENT_END();
+	if (Graphics.FrameResources[i].UniformRing.Overflow != NULL) { GrowUniformRing(i); }
+	INSTRUMENT_BEGIN("DescriptorFlush");
+	UpdateDescriptorSets(i);
+	INSTRUMENT_END();
+	ResetFrameArena(&Graphics.FrameResources[i].Arena);
+	Graphics.FrameResources[i].UniformRing.Offset = 0;
+	ResetRecordSlots(i);
+	if (Graphics.Profiler.Enabled) { ReadProfileQueries(i); }
 	
-	VkResult result = vkAcquireNextImageKHR(Graphics.Device, Graphics.Swapchain.Instance, UINT64_MAX, Graphics.FrameResources[i].ImageAvailable, VK_NULL_HANDLE, &Graphics.Swapchain.CurrentImageIndex);
-	if (result != VK_SUCCESS) { log_info("Unsuccessful aquire image: %i\n", result); }
-	while (result != VK_SUCCESS)
+	VkResult result;
+	if (!Graphics.Headless)
 	{
-		EventHandlerPoll();
+		INSTRUMENT_BEGIN("Acquire");
 		result = vkAcquireNextImageKHR(Graphics.Device, Graphics.Swapchain.Instance, UINT64_MAX, Graphics.FrameResources[i].ImageAvailable, VK_NULL_HANDLE, &Graphics.Swapchain.CurrentImageIndex);
+		INSTRUMENT_VULKAN_CALLS(1);
+		if (result != VK_SUCCESS) { log_info("Unsuccessful aquire image: %i\n", result); }
+		while (result != VK_SUCCESS)
+		{
+			EventHandlerPoll();
+			result = vkAcquireNextImageKHR(Graphics.Device, Graphics.Swapchain.Instance, UINT64_MAX, Graphics.FrameResources[i].ImageAvailable, VK_NULL_HANDLE, &Graphics.Swapchain.CurrentImageIndex);
+			INSTRUMENT_VULKAN_CALLS(1);
+		}
+		INSTRUMENT_END();
 	}
 	
 	vkResetCommandBuffer(Graphics.FrameResources[i].CommandBuffer, 0);
@@ -596,54 +1399,105 @@ void GraphicsAquireNextImage()
 		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
 	};
 	result = vkBeginCommandBuffer(Graphics.FrameResources[i].CommandBuffer, &beginInfo);
+	INSTRUMENT_VULKAN_CALLS(2);
 	if (result != VK_SUCCESS)
 	{
 		log_fatal("Failed to begin command buffer: %i\n", result);
 		exit(1);
 	}
+	Graphics.Recorder.CommandBuffer = Graphics.FrameResources[i].CommandBuffer;
+	ResetBoundState(&Graphics.Recorder);
+	if (Graphics.Profiler.Enabled)
+	{
+		vkCmdResetQueryPool(Graphics.FrameResources[i].CommandBuffer, Graphics.FrameResources[i].QueryPool, 0, Graphics.Profiler.Capacity * 2);
+		INSTRUMENT_VULKAN_CALLS(1);
+		Graphics.Profiler.Depth = 0;
+		Graphics.Profiler.Overflow = 0;
+		GraphicsProfileBegin("Frame");
+	}
+	INSTRUMENT_BEGIN("TransferAcquire");
+	Graphics.FrameResources[i].TransferWaitCount = TransferAcquire(i, &Graphics.FrameResources[i].TransferWaits);
+	INSTRUMENT_END();
+	INSTRUMENT_END();
+	// Everything between acquiring and presenting is command recording
+	INSTRUMENT_BEGIN("Recording");
 }
 
 void GraphicsPresent()
 {
 	unsigned int i = Graphics.FrameIndex;
+	INSTRUMENT_END();
+	INSTRUMENT_BEGIN("GraphicsPresent");
 	
+	if (Graphics.Profiler.Enabled)
+	{
+		int open = Graphics.Profiler.Depth + Graphics.Profiler.Overflow;
+		if (open > 1) { log_warn("%i profile scopes weren't ended before GraphicsPresent\n", open - 1); }
+		while (Graphics.Profiler.Depth + Graphics.Profiler.Overflow > 0) { GraphicsProfileEnd(); }
+	}
 	VkResult result = vkEndCommandBuffer(Graphics.FrameResources[i].CommandBuffer);
+	INSTRUMENT_VULKAN_CALLS(1);
+	struct GraphicsUniformRing * ring = &Graphics.FrameResources[i].UniformRing;
+	if (ring->Offset > 0) { vmaFlushAllocation(Graphics.Allocator, ring->Allocation, 0, MIN(ring->Offset, ring->Capacity)); }
+	if (ring->Overflow != NULL) { vmaFlushAllocation(Graphics.Allocator, ring->Overflow->Allocation, 0, MIN(ring->Overflow->Offset, ring->Overflow->Capacity)); }
 	if (result != VK_SUCCESS)
 	{
 		log_fatal("Failed to record command buffer: %i\n", result);
 		exit(1);
 	}
 
-	VkSemaphore * waitSemaphores = malloc((1 + Graphics.PreRenderSemaphores->Count) * sizeof(VkSemaphore));
-	VkPipelineStageFlags * waitStages = malloc((1 + Graphics.PreRenderSemaphores->Count) * sizeof(VkPipelineStageFlags));
-	waitSemaphores[0] = Graphics.FrameResources[i].ImageAvailable;
-	waitStages[0] = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-	for (int i = 0; i < Graphics.PreRenderSemaphores->Count; i++)
+	// Headless frames have no acquired image to wait on
+	int imageWaitCount = Graphics.Headless ? 0 : 1;
+	int transferWaitCount = Graphics.FrameResources[i].TransferWaitCount;
+	int waitCount = imageWaitCount + transferWaitCount;
+	VkSemaphore * waitSemaphores = GraphicsFrameAllocate(i, waitCount * sizeof(VkSemaphore));
+	VkPipelineStageFlags * waitStages = GraphicsFrameAllocate(i, waitCount * sizeof(VkPipelineStageFlags));
+	if (!Graphics.Headless)
+	{
+		waitSemaphores[0] = Graphics.FrameResources[i].ImageAvailable;
+		waitStages[0] = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	}
+	// Uploads only have to finish before the acquire barriers recorded at the start of the frame
+	for (int j = 0; j < transferWaitCount; j++)
 	{
-		waitSemaphores[i + 1] = *(VkSemaphore *)ListGetValue(Graphics.PreRenderSemaphores, i);
-		waitStages[i + 1] = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		waitSemaphores[imageWaitCount + j] = Graphics.FrameResources[i].TransferWaits[j];
+		waitStages[imageWaitCount + j] = VK_PIPELINE_STAGE_TRANSFER_BIT;
 	}
 	
-	ListClear(Graphics.PreRenderSemaphores);
+	// The buffer uploads of the frame run first, they end with a barrier so no semaphore is needed
+	VkCommandBuffer commandBuffers[2];
+	int commandBufferCount = 0;
+	INSTRUMENT_BEGIN("EndUploads");
+	VkCommandBuffer uploads = TransferEndUploads();
+	INSTRUMENT_END();
+	if (uploads != VK_NULL_HANDLE) { commandBuffers[commandBufferCount++] = uploads; }
+	commandBuffers[commandBufferCount++] = Graphics.FrameResources[i].CommandBuffer;
 	VkSubmitInfo submitInfo =
 	{
 		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.waitSemaphoreCount = 1 + Graphics.PreRenderSemaphores->Count,
+		.waitSemaphoreCount = waitCount,
 		.pWaitSemaphores = waitSemaphores,
 		.pWaitDstStageMask = waitStages,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &Graphics.FrameResources[i].CommandBuffer,
-		.signalSemaphoreCount = 1,
+		.commandBufferCount = commandBufferCount,
+		.pCommandBuffers = commandBuffers,
+		.signalSemaphoreCount = Graphics.Headless ? 0 : 1,
 		.pSignalSemaphores = &Graphics.FrameResources[i].RenderFinished,
 	};
 	result = vkQueueSubmit(Graphics.GraphicsQueue, 1, &submitInfo, Graphics.FrameResources[i].FrameReady);
+	INSTRUMENT_VULKAN_CALLS(1);
+	SDL_AtomicAdd(&Graphics.Statistics.QueueSubmits, 1);
 	if (result != VK_SUCCESS)
 	{
 		log_fatal("Failed to submit queue: %i\n", result);
 		exit(1);
 	}
-	free(waitSemaphores);
-	free(waitStages);
+	// The frame ready fence is all that's needed to know when a headless frame is done
+	if (Graphics.Headless)
+	{
+		INSTRUMENT_END();
+		INSTRUMENT_NEXT_FRAME();
+		return;
+	}
 	
 	VkPresentInfoKHR presentInfo =
 	{
@@ -655,6 +1509,9 @@ void GraphicsPresent()
 		.pImageIndices = &Graphics.Swapchain.CurrentImageIndex,
 	};
 	vkQueuePresentKHR(Graphics.PresentQueue, &presentInfo);
+	INSTRUMENT_VULKAN_CALLS(1);
+	INSTRUMENT_END();
+	INSTRUMENT_NEXT_FRAME();
 }
 
 void GraphicsDestroySwapchain()
@@ -662,13 +1519,19 @@ void GraphicsDestroySwapchain()
 	vkDeviceWaitIdle(Graphics.Device);
 	vkDestroyRenderPass(Graphics.Device, Graphics.RenderPass, NULL);
 	free(Graphics.Swapchain.Images);
-	vkDestroySwapchainKHR(Graphics.Device, Graphics.Swapchain.Instance, NULL);
+	if (!Graphics.Headless) { vkDestroySwapchainKHR(Graphics.Device, Graphics.Swapchain.Instance, NULL); }
 }
 
-void GraphicsBegin(FrameBuffer frameBuffer)
+// Commands can't be recorded inline in a render pass instance that executes secondary command buffers, so switching ends the instance and begins another.
+// The attachments are loaded and stored so nothing is lost
+static void BeginRenderPass(VkSubpassContents contents)
 {
-	Graphics.BoundFrameBuffer = frameBuffer;
-	
+	if (Graphics.BoundFrameBuffer == NULL || (Graphics.RenderPassActive && Graphics.SubpassContents == contents)) { return; }
+	if (Graphics.RenderPassActive)
+	{
+		vkCmdEndRenderPass(Graphics.Recorder.CommandBuffer);
+		INSTRUMENT_VULKAN_CALLS(1);
+	}
 	VkRenderPassBeginInfo renderPassBegin =
 	{
 		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
@@ -677,12 +1540,31 @@ void GraphicsBegin(FrameBuffer frameBuffer)
 		.renderArea = (VkRect2D)
 		{
 			.offset = { 0, 0 },
-			.extent = { frameBuffer->Width, frameBuffer->Height },
+			.extent = { Graphics.BoundFrameBuffer->Width, Graphics.BoundFrameBuffer->Height },
 		},
 		.clearValueCount = 0,
 		.pClearValues = NULL,
 	};
-	vkCmdBeginRenderPass(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, &renderPassBegin, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(Graphics.Recorder.CommandBuffer, &renderPassBegin, contents);
+	INSTRUMENT_VULKAN_CALLS(1);
+	Graphics.RenderPassActive = true;
+	Graphics.SubpassContents = contents;
+}
+
+// Gets the recorder of the calling thread, recording into the frame's command buffer opens an inline render pass instance if one isn't open
+static struct GraphicsRecorder * GetRecorder()
+{
+	struct GraphicsRecorder * recorder = SDL_TLSGet(Graphics.RecorderKey);
+	if (recorder != NULL) { return recorder; }
+	BeginRenderPass(VK_SUBPASS_CONTENTS_INLINE);
+	return &Graphics.Recorder;
+}
+
+void GraphicsBegin(FrameBuffer frameBuffer)
+{
+	Graphics.BoundFrameBuffer = frameBuffer;
+	// The render pass instance is begun by the first command, once it's known whether the commands are inline or in secondary command buffers
+	Graphics.RenderPassActive = false;
 }
 
 static void Clear(Color clearColor, float depth, int stencil, VkImageAspectFlagBits aspect)
@@ -708,7 +1590,8 @@ static void Clear(Color clearColor, float depth, int stencil, VkImageAspectFlagB
 		.aspectMask = aspect,
 		.clearValue = { .depthStencil = { .depth = depth, .stencil = stencil }, }
 	};
-	vkCmdClearAttachments(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, 1, &clear, 1, &rect);
+	vkCmdClearAttachments(GetRecorder()->CommandBuffer, 1, &clear, 1, &rect);
+	INSTRUMENT_VULKAN_CALLS(1);
 }
 
 void GraphicsClearColor(Color clearColor)
@@ -732,10 +1615,10 @@ void GraphicsClear(Color clearColor, Scalar depth, int stencil)
 	Clear(clearColor, depth, stencil, VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT);
 }
 
-void GraphicsBindPipeline(Pipeline pipeline)
+static void BindDynamicState(struct GraphicsRecorder * recorder, Pipeline pipeline)
 {
-	Graphics.BoundPipeline = pipeline;
-	vkCmdBindPipeline(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->Instance);
+	VkCommandBuffer commandBuffer = recorder->CommandBuffer;
+	struct GraphicsBoundState * bound = &recorder->Bound;
 	VkViewport viewport =
 	{
 		.x = 0.0f,
@@ -750,37 +1633,487 @@ void GraphicsBindPipeline(Pipeline pipeline)
 		.offset = { 0, 0 },
 		.extent = Graphics.Swapchain.Extent,
 	};
-	vkCmdSetViewport(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, 0, 1, &viewport);
-	vkCmdSetScissor(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, 0, 1, &scissor);
-	vkCmdSetLineWidth(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, pipeline->LineWidth);
-	vkCmdSetStencilReference(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, VK_STENCIL_FACE_FRONT_BIT, pipeline->FrontStencilReference);
-	vkCmdSetStencilReference(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, VK_STENCIL_FACE_BACK_BIT, pipeline->BackStencilReference);
+	int skipped = 0;
+	if (!bound->DynamicStateSet || memcmp(&bound->Viewport, &viewport, sizeof(VkViewport)) != 0)
+	{
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		INSTRUMENT_VULKAN_CALLS(1);
+		bound->Viewport = viewport;
+	}
+	else { skipped++; }
+	if (!bound->DynamicStateSet || memcmp(&bound->Scissor, &scissor, sizeof(VkRect2D)) != 0)
+	{
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		INSTRUMENT_VULKAN_CALLS(1);
+		bound->Scissor = scissor;
+	}
+	else { skipped++; }
+	if (!bound->DynamicStateSet || bound->LineWidth != pipeline->LineWidth)
+	{
+		vkCmdSetLineWidth(commandBuffer, pipeline->LineWidth);
+		INSTRUMENT_VULKAN_CALLS(1);
+		bound->LineWidth = pipeline->LineWidth;
+	}
+	else { skipped++; }
+	if (!bound->DynamicStateSet || bound->FrontStencilReference != pipeline->FrontStencilReference)
+	{
+		vkCmdSetStencilReference(commandBuffer, VK_STENCIL_FACE_FRONT_BIT, pipeline->FrontStencilReference);
+		INSTRUMENT_VULKAN_CALLS(1);
+		bound->FrontStencilReference = pipeline->FrontStencilReference;
+	}
+	else { skipped++; }
+	if (!bound->DynamicStateSet || bound->BackStencilReference != pipeline->BackStencilReference)
+	{
+		vkCmdSetStencilReference(commandBuffer, VK_STENCIL_FACE_BACK_BIT, pipeline->BackStencilReference);
+		INSTRUMENT_VULKAN_CALLS(1);
+		bound->BackStencilReference = pipeline->BackStencilReference;
+	}
+	else { skipped++; }
+	bound->DynamicStateSet = true;
+	recorder->Statistics->RedundantDynamicStates += skipped;
+}
+
+// Push constants stay valid across pipelines whose layouts have the same push constant range
+static void BindPushConstants(struct GraphicsRecorder * recorder, Pipeline pipeline)
+{
+	struct GraphicsBoundState * bound = &recorder->Bound;
+	VkPushConstantRange range = pipeline->SharedLayout->PushConstantRange;
+	bool compatible = bound->PushConstantRange.stageFlags == range.stageFlags && bound->PushConstantRange.offset == range.offset && bound->PushConstantRange.size == range.size;
+	if (compatible && memcmp(bound->PushConstantData, pipeline->PushConstantData, pipeline->PushConstantSize) == 0)
+	{
+		recorder->Statistics->RedundantPushConstants++;
+		return;
+	}
+	vkCmdPushConstants(recorder->CommandBuffer, pipeline->Layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, pipeline->PushConstantSize, pipeline->PushConstantData);
+	INSTRUMENT_VULKAN_CALLS(1);
+	if (bound->PushConstantCapacity < pipeline->PushConstantSize)
+	{
+		bound->PushConstantCapacity = pipeline->PushConstantSize;
+		bound->PushConstantData = realloc(bound->PushConstantData, bound->PushConstantCapacity);
+	}
+	memcpy(bound->PushConstantData, pipeline->PushConstantData, pipeline->PushConstantSize);
+	bound->PushConstantRange = range;
+}
+
+void GraphicsBindPipeline(Pipeline pipeline)
+{
+	struct GraphicsRecorder * recorder = GetRecorder();
+	PipelineWait(pipeline);
+	// Every pipeline has its own descriptor sets, the bound set is only kept when it's the same set with a compatible layout
+	if (recorder->BoundPipeline == NULL || recorder->BoundPipeline->Layout != pipeline->Layout || recorder->BoundPipeline->DescriptorSet != pipeline->DescriptorSet)
+	{
+		recorder->DescriptorSetDirty = true;
+	}
+	else if (!recorder->DescriptorSetDirty) { recorder->DescriptorBindSkipped = true; }
+	recorder->BoundPipeline = pipeline;
 	
-	if (pipeline->UsesPushConstant)
+	if (recorder->Bound.Pipeline != pipeline->Instance)
+	{
+		vkCmdBindPipeline(recorder->CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->Instance);
+		INSTRUMENT_VULKAN_CALLS(1);
+		recorder->Bound.Pipeline = pipeline->Instance;
+	}
+	else { recorder->Statistics->RedundantPipelineBinds++; }
+	BindDynamicState(recorder, pipeline);
+	if (pipeline->UsesPushConstant) { BindPushConstants(recorder, pipeline); }
+	// The descriptor set is bound by the next draw, once the uniform offsets are known
+}
+
+// Counts the descriptor set bind that the pipeline bind would have needed if the draw didn't have to bind anyways
+static void CountSkippedDescriptorBind(struct GraphicsRecorder * recorder, bool bound)
+{
+	if (recorder->DescriptorBindSkipped && !bound) { recorder->Statistics->RedundantDescriptorBinds++; }
+	recorder->DescriptorBindSkipped = false;
+}
+
+// Copies the bound pipeline's changed uniform buffers into the uniform ring and binds them.
+// Returns false if the uniform ring and its overflow block are both full, then the draw is skipped rather than reading another buffer's data
+static bool PrepareDraw(struct GraphicsRecorder * recorder)
+{
+	Pipeline pipeline = recorder->BoundPipeline;
+	if (!pipeline->UsesDescriptors)
+	{
+		bool bind = pipeline->UsesBindless && recorder->DescriptorSetDirty;
+		if (bind)
+		{
+			VkDescriptorSet set = BindlessGetSet();
+			vkCmdBindDescriptorSets(recorder->CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->Layout, BindlessSet, 1, &set, 0, NULL);
+			INSTRUMENT_VULKAN_CALLS(1);
+			recorder->DescriptorSetDirty = false;
+		}
+		CountSkippedDescriptorBind(recorder, bind);
+		return true;
+	}
+	int frameNumber = SDL_AtomicGet(&Graphics.FrameNumber);
+	struct GraphicsUniformRing * ring = &Graphics.FrameResources[Graphics.FrameIndex].UniformRing;
+	// Every uniform of a draw has to be in the same buffer, once the ring is full they all go to the overflow block
+	bool overflow = ring->Overflow != NULL;
+	bool changed = recorder->DescriptorSetDirty || recorder->DescriptorSetOverflow != overflow;
+	// The offsets are only compared while the same layout stays bound, binding a new layout marks the set dirty
+	if (recorder->DynamicOffsetCapacity < pipeline->DynamicUniformCount)
+	{
+		recorder->DynamicOffsetCapacity = pipeline->DynamicUniformCount;
+		recorder->DynamicOffsets = realloc(recorder->DynamicOffsets, recorder->DynamicOffsetCapacity * sizeof(unsigned int));
+	}
+	for (int i = 0; i < pipeline->DynamicUniformCount; i++)
 	{
-		vkCmdPushConstants(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, pipeline->Layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, pipeline->PushConstantSize, pipeline->PushConstantData);
+		UniformBuffer uniform = pipeline->DynamicUniforms[i].Uniform;
+		unsigned int offset = 0;
+		if (uniform != NULL && !UploadUniform(uniform, frameNumber, overflow, &offset))
+		{
+			if (overflow)
+			{
+				// Some of the offsets were already replaced, so they no longer match the bound set
+				recorder->DescriptorSetDirty = true;
+				return false;
+			}
+			// The ring filled up part way through the draw's uniforms, they all start again in the overflow block
+			overflow = true;
+			changed = true;
+			i = -1;
+			continue;
+		}
+		if (changed || recorder->DynamicOffsets[i] != offset)
+		{
+			recorder->DynamicOffsets[i] = offset;
+			changed = true;
+		}
 	}
-	if (pipeline->UsesDescriptors)
+	CountSkippedDescriptorBind(recorder, changed);
+	if (!changed) { return true; }
+	VkDescriptorSet set = pipeline->DescriptorSet[Graphics.FrameIndex];
+	if (overflow)
 	{
-		vkCmdBindDescriptorSets(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->Layout, 0, 1, &pipeline->DescriptorSet[Graphics.FrameIndex], 0, NULL);
+		SDL_AtomicLock(&ring->Lock);
+		set = PipelineGetOverflowSet(pipeline, Graphics.FrameIndex, frameNumber, ring->Overflow->Buffer);
+		SDL_AtomicUnlock(&ring->Lock);
 	}
+	// The texture table is bound together with set 0, rebinding set 0 alone could disturb it when the previous pipeline's layout differed
+	VkDescriptorSet sets[] = { set, BindlessGetSet() };
+	vkCmdBindDescriptorSets(recorder->CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->Layout, 0, pipeline->UsesBindless ? 2 : 1, sets, pipeline->DynamicUniformCount, recorder->DynamicOffsets);
+	INSTRUMENT_VULKAN_CALLS(1);
+	recorder->DescriptorSetDirty = false;
+	recorder->DescriptorSetOverflow = overflow;
+	return true;
 }
 
 void GraphicsRenderVertexBuffer(VertexBuffer vertexBuffer)
-{	
+{
+	struct GraphicsRecorder * recorder = GetRecorder();
+	if (!PrepareDraw(recorder)) { return; }
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(recorder->CommandBuffer, 0, 1, &vertexBuffer->VertexBuffer, &offset);
+	vkCmdDraw(recorder->CommandBuffer, vertexBuffer->VertexCount, 1, 0, 0);
+	INSTRUMENT_VULKAN_CALLS(2);
+}
+
+void GraphicsRenderVertexRange(VertexBuffer vertexBuffer, int first, int count)
+{
+	struct GraphicsRecorder * recorder = GetRecorder();
+	if (!PrepareDraw(recorder)) { return; }
 	VkDeviceSize offset = 0;
-	vkCmdBindVertexBuffers(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, 0, 1, &vertexBuffer->VertexBuffer, &offset);
-	vkCmdDraw(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer, vertexBuffer->VertexCount, 1, 0, 0);
+	vkCmdBindVertexBuffers(recorder->CommandBuffer, 0, 1, &vertexBuffer->VertexBuffer, &offset);
+	vkCmdDraw(recorder->CommandBuffer, count, 1, first, 0);
+	INSTRUMENT_VULKAN_CALLS(2);
+}
+
+void GraphicsRenderInstanced(VertexBuffer mesh, VertexBuffer instances, int count)
+{
+	struct GraphicsRecorder * recorder = GetRecorder();
+	if (!PrepareDraw(recorder)) { return; }
+	VkBuffer buffers[] = { mesh->VertexBuffer, instances->VertexBuffer };
+	VkDeviceSize offsets[] = { 0, 0 };
+	vkCmdBindVertexBuffers(recorder->CommandBuffer, 0, 2, buffers, offsets);
+	vkCmdDraw(recorder->CommandBuffer, mesh->VertexCount, count, 0, 0);
+	INSTRUMENT_VULKAN_CALLS(2);
+}
+
+void GraphicsBindVertexBuffer(VertexBuffer vertexBuffer)
+{
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(GetRecorder()->CommandBuffer, 0, 1, &vertexBuffer->VertexBuffer, &offset);
+	INSTRUMENT_VULKAN_CALLS(1);
+}
+
+void GraphicsBindIndexBuffer(IndexBuffer indexBuffer)
+{
+	vkCmdBindIndexBuffer(GetRecorder()->CommandBuffer, indexBuffer->IndexBuffer, 0, (VkIndexType)indexBuffer->Type);
+	INSTRUMENT_VULKAN_CALLS(1);
+}
+
+void GraphicsRenderIndirect(IndirectBuffer indirectBuffer, int offset, int drawCount)
+{
+	struct GraphicsRecorder * recorder = GetRecorder();
+	if (!PrepareDraw(recorder)) { return; }
+	// Without multiDrawIndirect every command needs its own draw call
+	VkDeviceSize byteOffset = offset * sizeof(IndirectCommand);
+	while (drawCount > 0)
+	{
+		int count = MIN(drawCount, (int)Graphics.MaxDrawIndirectCount);
+		vkCmdDrawIndexedIndirect(recorder->CommandBuffer, indirectBuffer->Buffer, byteOffset, count, sizeof(IndirectCommand));
+		INSTRUMENT_VULKAN_CALLS(1);
+		byteOffset += count * sizeof(IndirectCommand);
+		drawCount -= count;
+	}
+}
+
+void GraphicsRenderIndexed(VertexBuffer vertexBuffer, IndexBuffer indexBuffer, int first, int count)
+{
+	struct GraphicsRecorder * recorder = GetRecorder();
+	if (!PrepareDraw(recorder)) { return; }
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(recorder->CommandBuffer, 0, 1, &vertexBuffer->VertexBuffer, &offset);
+	vkCmdBindIndexBuffer(recorder->CommandBuffer, indexBuffer->IndexBuffer, 0, (VkIndexType)indexBuffer->Type);
+	vkCmdDrawIndexed(recorder->CommandBuffer, count, 1, first, 0, 0);
+	INSTRUMENT_VULKAN_CALLS(3);
+}
+
+// Record jobs run on the worker threads while the render thread waits, it helps with them too
+static void RunRecordJob(void * data)
+{
+	struct RecordJob * record = data;
+	VkCommandBuffer commandBuffer = record->Slot->CommandBuffer;
+	VkCommandBufferInheritanceInfo inheritanceInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.renderPass = Graphics.RenderPass,
+		.subpass = 0,
+		.framebuffer = Graphics.BoundFrameBuffer->Instance,
+	};
+	VkCommandBufferBeginInfo beginInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+		.pInheritanceInfo = &inheritanceInfo,
+	};
+	VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	INSTRUMENT_VULKAN_CALLS(1);
+	if (result != VK_SUCCESS)
+	{
+		log_fatal("Failed to begin a secondary command buffer: %i\n", result);
+		exit(1);
+	}
+	record->Recorder = (struct GraphicsRecorder)
+	{
+		.CommandBuffer = commandBuffer,
+		.DynamicOffsets = record->Slot->DynamicOffsets,
+		.DynamicOffsetCapacity = record->Slot->DynamicOffsetCapacity,
+		.Bound.PushConstantData = record->Slot->PushConstantData,
+		.Bound.PushConstantCapacity = record->Slot->PushConstantCapacity,
+		.Statistics = &record->Statistics,
+	};
+	
+	// A thread waiting on a job inside another record job can run this one, so the recorder it replaces is put back
+	void * previous = SDL_TLSGet(Graphics.RecorderKey);
+	SDL_TLSSet(Graphics.RecorderKey, &record->Recorder, NULL);
+	record->Job.Function(record->Job.Data);
+	SDL_TLSSet(Graphics.RecorderKey, previous, NULL);
+	
+	result = vkEndCommandBuffer(commandBuffer);
+	INSTRUMENT_VULKAN_CALLS(1);
+	if (result != VK_SUCCESS)
+	{
+		log_fatal("Failed to record a secondary command buffer: %i\n", result);
+		exit(1);
+	}
+	record->Slot->DynamicOffsets = record->Recorder.DynamicOffsets;
+	record->Slot->DynamicOffsetCapacity = record->Recorder.DynamicOffsetCapacity;
+	record->Slot->PushConstantData = record->Recorder.Bound.PushConstantData;
+	record->Slot->PushConstantCapacity = record->Recorder.Bound.PushConstantCapacity;
+}
+
+void GraphicsRecordParallel(GraphicsRecordJob * jobs, int count)
+{
+	if (count <= 0) { return; }
+	INSTRUMENT_BEGIN("RecordParallel");
+	int frameResource = Graphics.FrameIndex;
+	struct RecordJob * records = GraphicsFrameAllocate(frameResource, count * sizeof(struct RecordJob));
+	VkCommandBuffer * commandBuffers = GraphicsFrameAllocate(frameResource, count * sizeof(VkCommandBuffer));
+	struct GraphicsRecordSlot * slots = AcquireRecordSlots(frameResource, count);
+	for (int i = 0; i < count; i++)
+	{
+		records[i] = (struct RecordJob){ .Job = jobs[i], .Slot = slots + i };
+		JobStart(&records[i].Work, RunRecordJob, records + i);
+	}
+	for (int i = 0; i < count; i++)
+	{
+		JobWait(&records[i].Work);
+		commandBuffers[i] = records[i].Recorder.CommandBuffer;
+		Graphics.Statistics.RedundantPipelineBinds += records[i].Statistics.RedundantPipelineBinds;
+		Graphics.Statistics.RedundantDynamicStates += records[i].Statistics.RedundantDynamicStates;
+		Graphics.Statistics.RedundantPushConstants += records[i].Statistics.RedundantPushConstants;
+		Graphics.Statistics.RedundantDescriptorBinds += records[i].Statistics.RedundantDescriptorBinds;
+	}
+	
+	BeginRenderPass(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	vkCmdExecuteCommands(Graphics.Recorder.CommandBuffer, count, commandBuffers);
+	INSTRUMENT_VULKAN_CALLS(1);
+	// The state bound in the frame's command buffer is undefined after executing secondary command buffers
+	ResetBoundState(&Graphics.Recorder);
+	INSTRUMENT_END();
 }
 
 void GraphicsEnd()
 {
-	vkCmdEndRenderPass(Graphics.FrameResources[Graphics.FrameIndex].CommandBuffer);
+	if (Graphics.RenderPassActive)
+	{
+		vkCmdEndRenderPass(Graphics.Recorder.CommandBuffer);
+		INSTRUMENT_VULKAN_CALLS(1);
+	}
+	Graphics.RenderPassActive = false;
 	Graphics.BoundFrameBuffer = NULL;
 }
 
+// Timestamps are written into the frame's command buffer, which can't record them inside a render pass instance that executes secondary command buffers.
+// Such an instance is ended and an inline one begun, the same as for any other command.
+// Returns false when called from a record job, whose secondary command buffer can't be timed on its own
+static bool BeginProfileCommand()
+{
+	if (SDL_TLSGet(Graphics.RecorderKey) != NULL) { return false; }
+	if (Graphics.RenderPassActive) { BeginRenderPass(VK_SUBPASS_CONTENTS_INLINE); }
+	return true;
+}
+
+void GraphicsProfileBegin(const char * name)
+{
+	struct GraphicsProfiler * profiler = &Graphics.Profiler;
+	if (!profiler->Enabled) { return; }
+	if (!BeginProfileCommand())
+	{
+		log_warn("Profile scopes can't be used in a GraphicsRecordParallel job, %s won't be timed\n", name);
+		return;
+	}
+	struct GraphicsFrameResource * frame = Graphics.FrameResources + Graphics.FrameIndex;
+	// Scopes nested too deeply are only counted, so that their GraphicsProfileEnd doesn't pop the scope that encloses them
+	if (profiler->Overflow > 0 || profiler->Depth == sizeof(profiler->Stack) / sizeof(profiler->Stack[0]))
+	{
+		if (profiler->Overflow == 0) { log_warn("Profile scopes are nested too deeply, %s won't be timed\n", name); }
+		profiler->Overflow++;
+		return;
+	}
+	
+	// Scopes that don't fit are still pushed so that GraphicsProfileEnd stays balanced
+	int query = frame->ProfileQueryCount < profiler->Capacity ? frame->ProfileQueryCount++ : -1;
+	profiler->Stack[profiler->Depth++] = query;
+	if (query == -1) { return; }
+	frame->ProfileQueries[query] = (struct GraphicsProfileQuery){ .Name = name, .Depth = profiler->Depth - 1 };
+	vkCmdWriteTimestamp(frame->CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame->QueryPool, query * 2);
+	INSTRUMENT_VULKAN_CALLS(1);
+}
+
+void GraphicsProfileEnd()
+{
+	struct GraphicsProfiler * profiler = &Graphics.Profiler;
+	if (!profiler->Enabled || !BeginProfileCommand()) { return; }
+	if (profiler->Overflow > 0)
+	{
+		profiler->Overflow--;
+		return;
+	}
+	if (profiler->Depth == 0) { return; }
+	struct GraphicsFrameResource * frame = Graphics.FrameResources + Graphics.FrameIndex;
+	int query = profiler->Stack[--profiler->Depth];
+	if (query == -1) { return; }
+	vkCmdWriteTimestamp(frame->CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame->QueryPool, query * 2 + 1);
+	INSTRUMENT_VULKAN_CALLS(1);
+}
+
+int GraphicsProfileGetScopeCount()
+{
+	return Graphics.Profiler.Enabled ? ListGetCount(Graphics.Profiler.Scopes) : 0;
+}
+
+GraphicsProfileResult GraphicsProfileGetScope(int index)
+{
+	struct ProfileScope * scope = ListGetValue(Graphics.Profiler.Scopes, index);
+	GraphicsProfileResult result = { .Name = scope->Name };
+	if (scope->SampleCount == 0) { return result; }
+	
+	result.Last = scope->Samples[(scope->NextSample + ProfileSampleCount - 1) % ProfileSampleCount];
+	result.Min = scope->Samples[0];
+	result.Max = scope->Samples[0];
+	double total = 0.0;
+	for (int i = 0; i < scope->SampleCount; i++)
+	{
+		result.Min = MIN(result.Min, scope->Samples[i]);
+		result.Max = MAX(result.Max, scope->Samples[i]);
+		total += scope->Samples[i];
+	}
+	result.Average = total / scope->SampleCount;
+	return result;
+}
+
+// Copies a string into buffer escaped for a JSON string, buffer must have room for 6 characters for every one in the string
+static void EscapeJSONString(const char * string, char * buffer)
+{
+	int length = 0;
+	for (const unsigned char * c = (const unsigned char *)string; *c != '\0'; c++)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			buffer[length++] = '\\';
+			buffer[length++] = *c;
+		}
+		else if (*c < 0x20) { length += sprintf(buffer + length, "\\u%04x", *c); }
+		else { buffer[length++] = *c; }
+	}
+	buffer[length] = '\0';
+}
+
+bool GraphicsProfileDumpTrace(const char * path)
+{
+	File file = FileTryOpen(path, FileModeWriteBinary);
+	if (file == NULL)
+	{
+		log_warn("Unable to write the profile trace to %s\n", path);
+		return false;
+	}
+	
+	struct GraphicsProfiler * profiler = &Graphics.Profiler;
+	unsigned long offset = 0;
+	// Both buffers grow to fit the longest scope name
+	int lineCapacity = 256;
+	char * line = malloc(lineCapacity);
+	int nameCapacity = 64;
+	char * name = malloc(nameCapacity);
+	int length = snprintf(line, lineCapacity, "{\"traceEvents\":[\n");
+	FileWrite(file, offset, length, line);
+	offset += length;
+	int first = (profiler->TraceNext + profiler->TraceCapacity - profiler->TraceCount) % MAX(profiler->TraceCapacity, 1);
+	for (int i = 0; i < profiler->TraceCount; i++)
+	{
+		struct GraphicsProfileEvent * event = profiler->Trace + (first + i) % profiler->TraceCapacity;
+		int nameSize = (int)strlen(event->Name) * 6 + 1;
+		if (nameSize > nameCapacity)
+		{
+			nameCapacity = nameSize;
+			name = realloc(name, nameCapacity);
+		}
+		EscapeJSONString(event->Name, name);
+		// Chrome trace times are in microseconds
+		const char * format = "{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%i}}%s\n";
+		const char * separator = i + 1 < profiler->TraceCount ? "," : "";
+		length = snprintf(NULL, 0, format, name, event->Start * 1000.0, event->Duration * 1000.0, event->Depth, separator);
+		if (length + 1 > lineCapacity)
+		{
+			lineCapacity = length + 1;
+			line = realloc(line, lineCapacity);
+		}
+		snprintf(line, lineCapacity, format, name, event->Start * 1000.0, event->Duration * 1000.0, event->Depth, separator);
+		FileWrite(file, offset, length, line);
+		offset += length;
+	}
+	length = snprintf(line, lineCapacity, "],\"displayTimeUnit\":\"ms\"}\n");
+	FileWrite(file, offset, length, line);
+	FileClose(file);
+	free(name);
+	free(line);
+	return true;
+}
+
 void GraphicsCopyToSwapchain(FrameBuffer frameBuffer)
 {
+	if (Graphics.Headless) { return; }
 	unsigned int i = Graphics.FrameIndex;
 	
 	VkImageMemoryBarrier memoryBarrier =
@@ -832,62 +2165,60 @@ void GraphicsCopyToSwapchain(FrameBuffer frameBuffer)
 	memoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 	memoryBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 	vkCmdPipelineBarrier(Graphics.FrameResources[i].CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &memoryBarrier);
+	INSTRUMENT_VULKAN_CALLS(3);
 }
 
 void GraphicsStopOperations()
 {
 	vkDeviceWaitIdle(Graphics.Device);
+	// The current frame might still be recording commands that use queued objects
+	Graphics.CompletedFrame = SDL_AtomicGet(&Graphics.FrameNumber) - 1;
+	if (SDL_ThreadID() == Graphics.RenderThread) { DestroyQueuedObjects(false); }
 }
 
 void GraphicsDeinitialize()
 {
 	vkDeviceWaitIdle(Graphics.Device);
+	DestroyQueuedObjects(true);
+	free(Graphics.DestroyQueue.Entries);
+	ListDestroy(Graphics.DestroyQueue.Overflow);
+	DestroyProfiler();
+	TransferDeinitialize();
+	BindlessDeinitialize();
+	PipelineDeinitialize();
 	GraphicsDestroySwapchain();
-	ListDestroy(Graphics.PreRenderSemaphores);
 	for (int i = 0; i < Graphics.FrameResourceCount; i++)
 	{
-		for (int j = 0; j < Graphics.FrameResources[i].DestroyVertexBufferQueue->Count; j++)
-		{
-			VertexBuffer vertexBuffer = ListGetValue(Graphics.FrameResources[i].DestroyVertexBufferQueue, j);
-			VertexBufferDestroy(vertexBuffer);
-		}
-		ListDestroy(Graphics.FrameResources[i].DestroyVertexBufferQueue);
-		for (int j = 0; j < Graphics.FrameResources[i].DestroyUniformBufferQueue->Count; j++)
-		{
-			UniformBuffer uniformBuffer = ListGetValue(Graphics.FrameResources[i].DestroyUniformBufferQueue, j);
-			UniformBufferDestroy(uniformBuffer);
-		}
-		ListDestroy(Graphics.FrameResources[i].DestroyUniformBufferQueue);
-		for (int j = 0; j < Graphics.FrameResources[i].DestroyFrameBufferQueue->Count; j++)
-		{
-			FrameBuffer frameBuffer = ListGetValue(Graphics.FrameResources[i].DestroyFrameBufferQueue, j);
-			FrameBufferDestroy(frameBuffer);
-		}
-		ListDestroy(Graphics.FrameResources[i].DestroyFrameBufferQueue);
-		for (int j = 0; j < Graphics.FrameResources[i].DestroyPipelineQueue->Count; j++)
+		struct GraphicsUniformRing * ring = &Graphics.FrameResources[i].UniformRing;
+		if (ring->Overflow != NULL)
 		{
-			Pipeline pipeline = ListGetValue(Graphics.FrameResources[i].DestroyPipelineQueue, j);
-			PipelineDestroy(pipeline);
+			vmaDestroyBuffer(Graphics.Allocator, ring->Overflow->Buffer, ring->Overflow->Allocation);
+			free(ring->Overflow);
 		}
-		ListDestroy(Graphics.FrameResources[i].DestroyPipelineQueue);
-		for (int j = 0; j < Graphics.FrameResources[i].DestroyTextureQueue->Count; j++)
+		vmaDestroyBuffer(Graphics.Allocator, ring->Buffer, ring->Allocation);
+	}
+	for (int i = 0; i < Graphics.FrameResourceCount; i++)
+	{
+		free(Graphics.FrameResources[i].DescriptorWrites);
+		Graphics.FrameResources[i].Arena.Overflow = 0;
+		for (int j = 0; j < ListGetCount(Graphics.FrameResources[i].Arena.OverflowBlocks); j++)
 		{
-			Texture texture = ListGetValue(Graphics.FrameResources[i].DestroyTextureQueue, j);
-			TextureDestroy(texture);
+			free(ListGetValue(Graphics.FrameResources[i].Arena.OverflowBlocks, j));
 		}
-		ListDestroy(Graphics.FrameResources[i].DestroyTextureQueue);
-		
-		ListDestroy(Graphics.FrameResources[i].UpdateDescriptorQueue);
+		ListDestroy(Graphics.FrameResources[i].Arena.OverflowBlocks);
+		free(Graphics.FrameResources[i].Arena.Data);
 		vkDestroyFence(Graphics.Device, Graphics.FrameResources[i].FrameReady, NULL);
 		vkDestroySemaphore(Graphics.Device, Graphics.FrameResources[i].RenderFinished, NULL);
 		vkDestroySemaphore(Graphics.Device, Graphics.FrameResources[i].ImageAvailable, NULL);
 		vkFreeCommandBuffers(Graphics.Device, Graphics.CommandPool, 1, &Graphics.FrameResources[i].CommandBuffer);
 	}
+	DestroyRecorders();
 	free(Graphics.FrameResources);
 	shaderc_compiler_release(Graphics.ShaderCompiler);
+	DestroyPipelineCache();
 	vmaDestroyAllocator(Graphics.Allocator);
 	vkDestroyCommandPool(Graphics.Device, Graphics.CommandPool, NULL);
 	vkDestroyDevice(Graphics.Device, NULL);
-	vkDestroySurfaceKHR(Graphics.Instance, Graphics.Surface, NULL);
+	if (!Graphics.Headless) { vkDestroySurfaceKHR(Graphics.Instance, Graphics.Surface, NULL); }
 	vkDestroyInstance(Graphics.Instance, NULL);
 }
@@ -4,8 +4,12 @@
 #include <vulkan/vulkan.h>
 #include <shaderc/shaderc.h>
 #include <vk_mem_alloc.h>
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_thread.h>
 #include "Pipeline.h"
 #include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "IndirectBuffer.h"
 #include "LinearMath.h"
 #include "UniformBuffer.h"
 #include "FrameBuffer.h"
@@ -23,8 +27,68 @@ typedef struct GraphicsConfigure
 	/// Recommended 3 for maximum cpu and gpu balance
 	/// Anything higher than 1 won't make a difference if the device doesn't support tripple buffering
 	int FrameResourceCount;
+	/// The file used to store the pipeline cache between runs.
+	/// The cache is loaded at initialization and written back at deinitialization.
+	/// If NULL then the cache is only kept in memory
+	const char * PipelineCachePath;
+	/// The directory used to store compiled GLSL shaders between runs.
+	/// It's created if it doesn't exist. If NULL then shaders are compiled every time they're loaded
+	const char * ShaderCachePath;
+	/// The number of worker threads used for background work such as PipelineCreateAsync.
+	/// 0 creates one less than the number of cores
+	int WorkerThreadCount;
+	/// The number of objects that can be waiting to be destroyed in the lock free ring at once, more are kept in a slower list.
+	/// It's rounded up to a power of two, 0 defaults to 4096
+	int DestroyQueueCapacity;
+	/// The size in bytes of the per-frame memory used for temporary allocations.
+	/// It grows if a frame needs more, 0 defaults to 64KB
+	int FrameArenaSize;
+	/// Whether or not to run without a window, surface and swapchain.
+	/// Rendering is done into framebuffers only, GraphicsPresent just submits the frame,
+	/// and GraphicsCopyToSwapchain does nothing. Useful for benchmarking and machines without a display
+	bool Headless;
+	/// The number of GraphicsProfileBegin scopes that can be timed in one frame.
+	/// 0 disables gpu profiling
+	int ProfileScopeCount;
+	/// The size in bytes of each frame resource's uniform memory, every draw copies the uniform buffers it uses into it.
+	/// A frame that needs more warns and continues in an overflow block, then the memory grows. 0 defaults to 4MB
+	int UniformRingSize;
+	/// The size in bytes of the staging memory shared by every vertex, index, indirect and texture upload.
+	/// Uploads that don't fit get their own allocation, 0 defaults to 16MB
+	int StagingRingSize;
+	/// The number of textures the bindless texture table can hold, it's clamped to what the device supports.
+	/// The table is only created if the device supports descriptor indexing, 0 defaults to 4096
+	int BindlessTextureCount;
 } GraphicsConfigure;
 
+/// The timing results of a profile scope in milliseconds, taken over its most recent frames
+typedef struct GraphicsProfileResult
+{
+	const char * Name;
+	double Last;
+	double Min;
+	double Average;
+	double Max;
+} GraphicsProfileResult;
+
+/// A function that records draws for GraphicsRecordParallel
+typedef struct GraphicsRecordJob
+{
+	void (*Function)(void * data);
+	void * Data;
+} GraphicsRecordJob;
+
+typedef enum GraphicsDestroyType
+{
+	GraphicsDestroyTypeVertexBuffer,
+	GraphicsDestroyTypeUniformBuffer,
+	GraphicsDestroyTypeFrameBuffer,
+	GraphicsDestroyTypePipeline,
+	GraphicsDestroyTypeTexture,
+	GraphicsDestroyTypeIndexBuffer,
+	GraphicsDestroyTypeIndirectBuffer,
+} GraphicsDestroyType;
+
 struct Graphics
 {
 	VkInstance Instance;
@@ -35,6 +99,20 @@ struct Graphics
 	unsigned int GraphicsQueueIndex;
 	VkQueue PresentQueue;
 	unsigned int PresentQueueIndex;
+	/// A transfer-only queue if the device has one, otherwise a queue that shares a family with graphics work
+	VkQueue TransferQueue;
+	unsigned int TransferQueueIndex;
+	bool PipelineCreationFeedback;
+	bool Headless;
+	bool MultiDrawIndirect;
+	unsigned int MaxDrawIndirectCount;
+	/// 1 if the device doesn't support anisotropic filtering
+	float MaxSamplerAnisotropy;
+	/// Whether or not BC1 to BC7 textures can be created
+	bool TextureCompressionBC;
+	/// Whether or not the bindless texture table is available, otherwise array textures can be used to index textures in shaders
+	bool DescriptorIndexing;
+	unsigned int MaxBindlessTextures;
 	
 	struct GraphicsSwapchain
 	{
@@ -49,8 +127,10 @@ struct Graphics
 	VkRenderPass RenderPass;
 	VkCommandPool CommandPool;
 	VmaAllocator Allocator;
+	VkPipelineCache PipelineCache;
+	const char * PipelineCachePath;
 	shaderc_compiler_t ShaderCompiler;
-	List PreRenderSemaphores;
+	const char * ShaderCachePath;
 	
 	int FrameResourceCount;
 	struct GraphicsFrameResource
@@ -59,17 +139,194 @@ struct Graphics
 		VkSemaphore ImageAvailable;
 		VkSemaphore RenderFinished;
 		VkFence FrameReady;
-		List DestroyVertexBufferQueue;
-		List DestroyUniformBufferQueue;
-		List DestroyFrameBufferQueue;
-		List DestroyPipelineQueue;
-		List DestroyTextureQueue;
-		List UpdateDescriptorQueue;
+		/// Descriptor writes waiting for the frame resource's descriptor sets to stop being used
+		struct GraphicsDescriptorWrite
+		{
+			VkDescriptorSet Set;
+			unsigned int Binding;
+			unsigned int ArrayElement;
+			VkDescriptorType Type;
+			unsigned int Order;
+			union
+			{
+				VkDescriptorBufferInfo Buffer;
+				VkDescriptorImageInfo Image;
+			} Info;
+		} * DescriptorWrites;
+		int DescriptorWriteCount;
+		int DescriptorWriteCapacity;
+		/// Memory for allocations that only need to live until the frame resource is used again
+		struct GraphicsFrameArena
+		{
+			unsigned char * Data;
+			size_t Capacity;
+			size_t Offset;
+			size_t Overflow;
+			List OverflowBlocks;
+		} Arena;
+		/// Timestamps written by the profile scopes of the frame, two queries per a scope
+		VkQueryPool QueryPool;
+		struct GraphicsProfileQuery
+		{
+			const char * Name;
+			int Depth;
+		} * ProfileQueries;
+		int ProfileQueryCount;
+		/// Persistently mapped memory that uniform buffers are copied into when drawing, bound with dynamic offsets
+		struct GraphicsUniformRing
+		{
+			VkBuffer Buffer;
+			VmaAllocation Allocation;
+			unsigned char * Data;
+			unsigned int Capacity;
+			/// The bytes the frame has used, it goes past Capacity if the frame needed more
+			unsigned int Offset;
+			/// Held while allocating, record jobs can draw at the same time
+			SDL_SpinLock Lock;
+			/// Where the rest of the frame's uniforms go once the ring is full, the draws that use it bind the pipelines' overflow descriptor sets.
+			/// It's created by the first frame that fills the ring, which grows to fit both the next time its frame resource is acquired
+			struct GraphicsUniformRing * Overflow;
+		} UniformRing;
+		/// The semaphores of the uploads that the frame acquired, waited on at the transfer stage
+		VkSemaphore * TransferWaits;
+		int TransferWaitCount;
+		/// Where the frame's record jobs record, the nth job of the frame uses the nth slot.
+		/// Command pools can only be used by one thread at a time, so each slot has its own
+		struct GraphicsRecordSlot
+		{
+			VkCommandPool CommandPool;
+			VkCommandBuffer CommandBuffer;
+			/// The buffers of the last recorder that used the slot, kept so that recording doesn't allocate once they've grown
+			unsigned int * DynamicOffsets;
+			int DynamicOffsetCapacity;
+			unsigned char * PushConstantData;
+			unsigned int PushConstantCapacity;
+		} * RecordSlots;
+		int RecordSlotCount;
+		/// The number of slots used since the frame resource was acquired
+		int RecordSlotsUsed;
 	} * FrameResources;
 	int FrameIndex;
+	/// The number of the frame currently being recorded, it increases every GraphicsAquireNextImage
+	SDL_atomic_t FrameNumber;
+	/// Every frame up to and including this number has finished executing on the gpu
+	int CompletedFrame;
+	SDL_threadID RenderThread;
+	
+	/// A lock free ring of objects waiting for the gpu to finish using them before they're destroyed
+	struct GraphicsDestroyQueue
+	{
+		unsigned int Capacity;
+		struct GraphicsDestroyEntry
+		{
+			SDL_atomic_t Sequence;
+			GraphicsDestroyType Type;
+			void * Object;
+			int Frame;
+		} * Entries;
+		SDL_atomic_t Tail;
+		unsigned int Head;
+		/// Entries that didn't fit in the ring, they're destroyed the same way
+		List Overflow;
+		SDL_SpinLock OverflowLock;
+	} DestroyQueue;
 	
 	FrameBuffer BoundFrameBuffer;
-	Pipeline BoundPipeline;
+	/// Whether or not a render pass instance is open on the frame's command buffer, GraphicsBegin leaves opening one to the first command recorded into it
+	bool RenderPassActive;
+	/// Whether the open render pass instance records commands inline or executes secondary command buffers
+	VkSubpassContents SubpassContents;
+	unsigned int UniformAlignment;
+	/// The state of a command buffer being recorded.
+	/// The frame's command buffer uses Recorder, each secondary command buffer of GraphicsRecordParallel gets its own
+	struct GraphicsRecorder
+	{
+		VkCommandBuffer CommandBuffer;
+		Pipeline BoundPipeline;
+		/// Whether or not the bound pipeline's descriptor set needs to be bound again before the next draw
+		bool DescriptorSetDirty;
+		/// Whether or not binding the pipeline kept the descriptor set that was already bound
+		bool DescriptorBindSkipped;
+		/// Whether or not the bound descriptor set is the pipeline's overflow set, which views the uniform ring's overflow block
+		bool DescriptorSetOverflow;
+		/// The dynamic uniform offsets the descriptor set was last bound with
+		unsigned int * DynamicOffsets;
+		int DynamicOffsetCapacity;
+		/// The state last recorded into the command buffer, commands that wouldn't change it are skipped
+		struct GraphicsBoundState
+		{
+			VkPipeline Pipeline;
+			/// Whether or not the dynamic state below has been recorded yet
+			bool DynamicStateSet;
+			VkViewport Viewport;
+			VkRect2D Scissor;
+			float LineWidth;
+			unsigned int FrontStencilReference;
+			unsigned int BackStencilReference;
+			/// The push constant range of the layout the push constants were last pushed with, zero if none were pushed
+			VkPushConstantRange PushConstantRange;
+			unsigned char * PushConstantData;
+			unsigned int PushConstantCapacity;
+		} Bound;
+		/// Where the redundant commands that were skipped are counted, record jobs count separately and are added to Graphics.Statistics once they finish
+		struct GraphicsStatistics * Statistics;
+	} Recorder;
+	/// Holds the recorder of the record job running on the calling thread, NULL records into the frame's command buffer
+	SDL_TLSID RecorderKey;
+	
+	struct GraphicsProfiler
+	{
+		bool Enabled;
+		int Capacity;
+		/// Nanoseconds per a timestamp tick
+		double TimestampPeriod;
+		unsigned long long TimestampMask;
+		unsigned long long TimeBase;
+		int Stack[16];
+		int Depth;
+		/// The number of open scopes that were begun once Stack was full, they're ended before any scope in Stack
+		int Overflow;
+		/// The rolling timings of every scope name that has been seen
+		List Scopes;
+		/// A ring of the most recent scope timings for GraphicsProfileDumpTrace
+		struct GraphicsProfileEvent
+		{
+			const char * Name;
+			int Depth;
+			double Start;
+			double Duration;
+		} * Trace;
+		int TraceCapacity;
+		int TraceCount;
+		int TraceNext;
+	} Profiler;
+	
+	struct GraphicsStatistics
+	{
+		/// The number of vkQueueSubmit calls on the graphics and transfer queues (read with SDL_AtomicGet)
+		SDL_atomic_t QueueSubmits;
+		/// The number of pipelines that were created from the pipeline cache (read with SDL_AtomicGet).
+		/// Pipeline cache hits and misses are only counted if the device supports VK_EXT_pipeline_creation_feedback
+		SDL_atomic_t PipelineCacheHits;
+		/// The number of pipelines that had to be compiled by the driver (read with SDL_AtomicGet)
+		SDL_atomic_t PipelineCacheMisses;
+		/// The number of GLSL shaders that were loaded from the shader cache (read with SDL_AtomicGet)
+		SDL_atomic_t ShaderCacheHits;
+		/// The number of GLSL shaders that had to be compiled (read with SDL_AtomicGet)
+		SDL_atomic_t ShaderCacheMisses;
+		/// The number of frame arena allocations that didn't fit and fell back to the heap
+		unsigned long FrameArenaOverflows;
+		/// The number of queued descriptor writes that were dropped or merged into another write
+		unsigned long DescriptorWritesCoalesced;
+		/// The number of pipeline binds that were skipped because the pipeline was already bound
+		unsigned long RedundantPipelineBinds;
+		/// The number of viewport, scissor, line width and stencil reference commands that were skipped because the value was already set
+		unsigned long RedundantDynamicStates;
+		/// The number of push constant updates that were skipped because the bytes hadn't changed
+		unsigned long RedundantPushConstants;
+		/// The number of descriptor set binds that were skipped because the same set was already bound
+		unsigned long RedundantDescriptorBinds;
+	} Statistics;
 } extern Graphics;
 
 /// This should not be called by the user, it is called in the XGIInitialize function
@@ -78,12 +335,36 @@ void GraphicsInitialize(GraphicsConfigure config);
 /// This should not be called, it is automatically called at initialization, and when the window is resized.
 void GraphicsCreateSwapchain(int width, int height);
 
+/// Places an object into the destroy queue, it's destroyed once the gpu has finished every frame that could be using it.
+/// This can be called from any thread.
+/// The user shouldn't call this, use the QueueDestroy function of the object instead
+/// \param type The type of the object
+/// \param object The object to destroy
+void GraphicsQueueDestroy(GraphicsDestroyType type, void * object);
+
+/// Allocates temporary memory from the arena of a frame resource.
+/// The memory is freed the next time that frame resource is acquired, after its queued descriptor writes are applied.
+/// The user shouldn't need to call this
+/// \param frameResource The index of the frame resource
+/// \param size The size in bytes to allocate
+/// \return A pointer to the allocated memory
+void * GraphicsFrameAllocate(int frameResource, size_t size);
+
+/// Queues a descriptor write for the descriptor sets of a frame resource.
+/// The writes are applied together the next time that frame resource is acquired,
+/// only the last write to each descriptor is kept.
+/// The user shouldn't need to call this
+/// \param frameResource The index of the frame resource
+/// \param write The descriptor write to queue
+void GraphicsQueueDescriptorWrite(int frameResource, struct GraphicsDescriptorWrite write);
+
 /// Acquires the next swapchain image for rendering.
 /// This should be called once per a frame, before any rendering operations are done
 void GraphicsAquireNextImage(void);
 
 /// Presents the acquired image to the screen
-/// This should be called once per a frame, after all render calls have been finished
+/// This should be called once per a frame, after all render calls have been finished.
+/// In headless mode the frame is only submitted
 void GraphicsPresent(void);
 
 /// This should not be called, it is automatically called at deinitialization, and when the window is resized.
@@ -119,6 +400,9 @@ void GraphicsClear(Color clearColor, Scalar depth, int stencil);
 /// Binds a pipeline to use for rendering.
 /// This shoud only be called after GraphicsBegin and before GraphicsEnd.
 /// Make sure all bindings that the shaders use are set with the pipeline before using it.
+/// Binding again after changing push constants only pushes them, state that's already bound isn't recorded again (see Graphics.Statistics)
+/// Pipelines with the same shader interface share their layouts but not their descriptor sets, so switching between them binds the new pipeline's set.
+/// Only binding the same pipeline again keeps the bound descriptor set
 /// \param pipeline The pipeline to bind
 void GraphicsBindPipeline(Pipeline pipeline);
 
@@ -127,10 +411,91 @@ void GraphicsBindPipeline(Pipeline pipeline);
 /// A pipeline must be bound before calling this
 void GraphicsRenderVertexBuffer(VertexBuffer vertexBuffer);
 
+/// Renders part of a vertexbuffer to the currently bound framebuffer using the currently bound pipeline.
+/// This shoud only be called after GraphicsBegin and before GraphicsEnd.
+/// A pipeline must be bound before calling this
+/// \param vertexBuffer The vertices to render
+/// \param first The first vertex to render
+/// \param count The number of vertices to render
+void GraphicsRenderVertexRange(VertexBuffer vertexBuffer, int first, int count);
+
+/// Renders many instances of a mesh with one draw call.
+/// The bound pipeline's vertex layout should have the mesh at binding 0 and the per-instance data at binding 1.
+/// This shoud only be called after GraphicsBegin and before GraphicsEnd
+/// \param mesh The per-vertex data of the mesh
+/// \param instances The per-instance data, one element for each instance
+/// \param count The number of instances to render
+void GraphicsRenderInstanced(VertexBuffer mesh, VertexBuffer instances, int count);
+
+/// Binds a vertexbuffer to binding 0 for GraphicsRenderIndirect.
+/// This shoud only be called after GraphicsBegin and before GraphicsEnd
+/// \param vertexBuffer The vertex buffer to bind
+void GraphicsBindVertexBuffer(VertexBuffer vertexBuffer);
+
+/// Binds an indexbuffer for GraphicsRenderIndirect.
+/// This shoud only be called after GraphicsBegin and before GraphicsEnd
+/// \param indexBuffer The index buffer to bind
+void GraphicsBindIndexBuffer(IndexBuffer indexBuffer);
+
+/// Renders the draw commands stored in an indirectbuffer using the bound vertex and index buffers.
+/// All of the draws are issued with one command if the device supports multiDrawIndirect.
+/// This shoud only be called after GraphicsBegin and before GraphicsEnd.
+/// A pipeline, vertex buffer, and index buffer must be bound before calling this
+/// \param indirectBuffer The buffer of draw commands
+/// \param offset The index of the first command to draw
+/// \param drawCount The number of commands to draw
+void GraphicsRenderIndirect(IndirectBuffer indirectBuffer, int offset, int drawCount);
+
+/// Renders the vertices of a vertexbuffer in the order given by an indexbuffer.
+/// This shoud only be called after GraphicsBegin and before GraphicsEnd.
+/// A pipeline must be bound before calling this
+/// \param vertexBuffer The vertices to render
+/// \param indexBuffer The indices into the vertex buffer
+/// \param first The first index to render
+/// \param count The number of indices to render
+void GraphicsRenderIndexed(VertexBuffer vertexBuffer, IndexBuffer indexBuffer, int first, int count);
+
+/// Records draws into secondary command buffers on the worker threads then executes them in the order of the jobs.
+/// The secondary command buffers continue the render pass and framebuffer from GraphicsBegin.
+/// Inside a job the usual functions such as GraphicsBindPipeline and GraphicsRenderIndexed record into the job's command buffer,
+/// nothing is bound when a job starts and nothing bound before or during the jobs stays bound after this returns.
+/// The pipelines, push constants and uniform buffers the jobs use must not be changed until this returns,
+/// so per-draw push constants need a pipeline for each job and a render queue can only be flushed from one job.
+/// Profile scopes can't be started in a job.
+/// This shoud only be called after GraphicsBegin and before GraphicsEnd, it blocks until every job has finished
+/// \param jobs The functions that record the draws, with the data to give them
+/// \param count The number of jobs
+void GraphicsRecordParallel(GraphicsRecordJob * jobs, int count);
+
 /// Ends rendering to a framebuffer.
 /// This should be called after GraphicsBegin and before SwapchainPresent
 void GraphicsEnd(void);
 
+/// Starts timing a section of the frame on the gpu, scopes can be nested.
+/// This does nothing if GraphicsConfigure.ProfileScopeCount is 0, or in a GraphicsRecordParallel job
+/// \param name The name of the scope, the string must stay valid for the lifetime of the program
+void GraphicsProfileBegin(const char * name);
+
+/// Stops timing the most recently started profile scope
+void GraphicsProfileEnd(void);
+
+/// Gets the number of different profile scopes that have results.
+/// The whole frame is always timed as a scope called "Frame"
+/// \return The scope count
+int GraphicsProfileGetScopeCount(void);
+
+/// Gets the gpu timings of a profile scope.
+/// Results are read back without stalling, so they lag FrameResourceCount frames behind
+/// \param index The index of the scope, from 0 to GraphicsProfileGetScopeCount
+/// \return The timings of the scope
+GraphicsProfileResult GraphicsProfileGetScope(int index);
+
+/// Writes the most recent scope timings to a file in the Chrome trace event format.
+/// It can be opened in chrome://tracing or Perfetto
+/// \param path The file path to write to
+/// \return Whether or not the file could be written
+bool GraphicsProfileDumpTrace(const char * path);
+
 /// Copies a framebuffer to the swapchain for rendering,
 /// This should only be called after GraphicsEnd and before SwapchainPresent
 void GraphicsCopyToSwapchain(FrameBuffer frameBuffer);
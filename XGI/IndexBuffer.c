@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <string.h>
+#include <vk_mem_alloc.h>
+#include "Graphics.h"
+#include "Transfer.h"
+#include "log.h"
+#include "IndexBuffer.h"
+
+#define VertexCacheSize 16
+
+IndexBuffer IndexBufferCreate(int indexCount, IndexType type, bool optimize)
+{
+	IndexBuffer indexBuffer = malloc(sizeof(struct IndexBuffer));
+	*indexBuffer = (struct IndexBuffer)
+	{
+		.IndexCount = indexCount,
+		.Type = type,
+		.IndexSize = type == IndexType16 ? sizeof(uint16_t) : sizeof(uint32_t),
+		.Optimize = optimize,
+	};
+
+	size_t size = indexCount * indexBuffer->IndexSize;
+
+	VkBufferCreateInfo bufferInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = size,
+		.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+	};
+	VmaAllocationCreateInfo allocationInfo =
+	{
+		.usage = VMA_MEMORY_USAGE_GPU_ONLY,
+	};
+	vmaCreateBuffer(Graphics.Allocator, &bufferInfo, &allocationInfo, &indexBuffer->IndexBuffer, &indexBuffer->IndexAllocation, NULL);
+
+	return indexBuffer;
+}
+
+void * IndexBufferMapIndices(IndexBuffer indexBuffer)
+{
+	// The staging memory is only held from mapping until the upload is recorded
+	if (!indexBuffer->Mapped)
+	{
+		indexBuffer->Staging = TransferStagingAllocate(indexBuffer->IndexCount * indexBuffer->IndexSize);
+		indexBuffer->Mapped = true;
+	}
+	return indexBuffer->Staging.Data;
+}
+
+void IndexBufferUnmapIndices(IndexBuffer indexBuffer)
+{
+	// The staging ring is persistently mapped, the region is released once the upload is recorded
+}
+
+static int SkipDeadEnd(const int * live, const int * deadEnd, int * deadEndCount, int * cursor, int vertexCount)
+{
+	while (*deadEndCount > 0)
+	{
+		int vertex = deadEnd[--(*deadEndCount)];
+		if (live[vertex] > 0) { return vertex; }
+	}
+	for (; *cursor < vertexCount; (*cursor)++)
+	{
+		if (live[*cursor] > 0) { return *cursor; }
+	}
+	return -1;
+}
+
+// Tipsify from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" by Sander, Nehab and Barczak.
+// Triangles are emitted by fanning around vertices that are likely to still be in the vertex cache
+static void OptimizeVertexCache(uint32_t * indices, int indexCount)
+{
+	int triangleCount = indexCount / 3;
+	int vertexCount = 0;
+	for (int i = 0; i < indexCount; i++) { vertexCount = MAX(vertexCount, (int)indices[i] + 1); }
+
+	// The triangles adjacent to vertex v are adjacency[offsets[v]] to adjacency[offsets[v + 1]]
+	int * live = calloc(vertexCount, sizeof(int));
+	int * offsets = calloc(vertexCount + 1, sizeof(int));
+	int * adjacency = malloc(indexCount * sizeof(int));
+	for (int i = 0; i < indexCount; i++) { live[indices[i]]++; }
+	for (int i = 0; i < vertexCount; i++) { offsets[i + 1] = offsets[i] + live[i]; }
+	int * fill = malloc(vertexCount * sizeof(int));
+	memcpy(fill, offsets, vertexCount * sizeof(int));
+	for (int i = 0; i < indexCount; i++) { adjacency[fill[indices[i]]++] = i / 3; }
+	free(fill);
+
+	int * cacheTime = calloc(vertexCount, sizeof(int));
+	bool * emitted = calloc(triangleCount, sizeof(bool));
+	int * deadEnd = malloc(indexCount * sizeof(int));
+	uint32_t * output = malloc(indexCount * sizeof(uint32_t));
+	int deadEndCount = 0, outputCount = 0, cursor = 0;
+	int time = VertexCacheSize + 1;
+
+	int fan = SkipDeadEnd(live, deadEnd, &deadEndCount, &cursor, vertexCount);
+	while (fan >= 0)
+	{
+		int candidatesStart = outputCount;
+		for (int i = offsets[fan]; i < offsets[fan + 1]; i++)
+		{
+			int triangle = adjacency[i];
+			if (emitted[triangle]) { continue; }
+			emitted[triangle] = true;
+			for (int j = 0; j < 3; j++)
+			{
+				uint32_t vertex = indices[triangle * 3 + j];
+				output[outputCount++] = vertex;
+				deadEnd[deadEndCount++] = vertex;
+				live[vertex]--;
+				if (time - cacheTime[vertex] > VertexCacheSize) { cacheTime[vertex] = time++; }
+			}
+		}
+
+		// Prefer the emitted vertex that will stay in the cache for its remaining triangles and entered it the earliest
+		int next = -1, bestPriority = -1;
+		for (int i = candidatesStart; i < outputCount; i++)
+		{
+			int vertex = output[i];
+			if (live[vertex] == 0) { continue; }
+			int priority = 0;
+			if (time - cacheTime[vertex] + 2 * live[vertex] <= VertexCacheSize) { priority = time - cacheTime[vertex]; }
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+		fan = next != -1 ? next : SkipDeadEnd(live, deadEnd, &deadEndCount, &cursor, vertexCount);
+	}
+	memcpy(indices, output, triangleCount * 3 * sizeof(uint32_t));
+
+	free(output);
+	free(deadEnd);
+	free(emitted);
+	free(cacheTime);
+	free(adjacency);
+	free(offsets);
+	free(live);
+}
+
+static void OptimizeIndices(IndexBuffer indexBuffer, void * data)
+{
+	if (indexBuffer->IndexCount < 3 || indexBuffer->IndexCount % 3 != 0) { return; }
+	if (indexBuffer->Type == IndexType32)
+	{
+		OptimizeVertexCache(data, indexBuffer->IndexCount);
+		return;
+	}
+	uint16_t * indices16 = data;
+	uint32_t * indices = malloc(indexBuffer->IndexCount * sizeof(uint32_t));
+	for (int i = 0; i < indexBuffer->IndexCount; i++) { indices[i] = indices16[i]; }
+	OptimizeVertexCache(indices, indexBuffer->IndexCount);
+	for (int i = 0; i < indexBuffer->IndexCount; i++) { indices16[i] = indices[i]; }
+	free(indices);
+}
+
+void IndexBufferUpload(IndexBuffer indexBuffer)
+{
+	if (!indexBuffer->Mapped)
+	{
+		log_warn("IndexBuffer was uploaded without being mapped, there is nothing to upload\n");
+		return;
+	}
+	if (indexBuffer->Optimize) { OptimizeIndices(indexBuffer, indexBuffer->Staging.Data); }
+	TransferUploadBuffer(indexBuffer->IndexBuffer, indexBuffer->Staging, indexBuffer->IndexCount * indexBuffer->IndexSize, &indexBuffer->UploadSequence);
+	indexBuffer->Mapped = false;
+}
+
+void IndexBufferQueueDestroy(IndexBuffer indexBuffer)
+{
+	GraphicsQueueDestroy(GraphicsDestroyTypeIndexBuffer, indexBuffer);
+}
+
+void IndexBufferDestroy(IndexBuffer indexBuffer)
+{
+	if (indexBuffer->Mapped) { TransferStagingRelease(indexBuffer->Staging); }
+	vmaDestroyBuffer(Graphics.Allocator, indexBuffer->IndexBuffer, indexBuffer->IndexAllocation);
+	free(indexBuffer);
+}
@@ -0,0 +1,68 @@
+#ifndef IndexBuffer_h
+#define IndexBuffer_h
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "Transfer.h"
+
+typedef enum IndexType
+{
+	/// Each index is a uint16_t, enough for 65536 vertices
+	IndexType16 = VK_INDEX_TYPE_UINT16,
+	/// Each index is a uint32_t
+	IndexType32 = VK_INDEX_TYPE_UINT32,
+} IndexType;
+
+typedef struct IndexBuffer
+{
+	int IndexCount;
+	IndexType Type;
+	int IndexSize;
+	bool Optimize;
+	TransferStaging Staging;
+	bool Mapped;
+	VkBuffer IndexBuffer;
+	VmaAllocation IndexAllocation;
+	unsigned long long UploadSequence;
+} * IndexBuffer;
+
+/// Creates an index buffer used for rendering with GraphicsRenderIndexed
+/// \param indexCount The number of indices to allocate
+/// \param type Whether the indices are 16 or 32 bit
+/// \param optimize Whether or not to reorder the triangles for the gpu's vertex cache when uploading.
+/// Only use this with triangle lists when the order the triangles are drawn in doesn't matter
+/// \return The newly created index buffer
+IndexBuffer IndexBufferCreate(int indexCount, IndexType type, bool optimize);
+
+/// Allows for copying data into an index buffer.
+/// This function only stages the memory onto the cpu, call IndexBufferUpload for it to be visible on the gpu.
+/// The memory comes from the staging ring and isn't kept after uploading, so every index must be written each time.
+/// The staging memory is held until the upload, so a buffer shouldn't stay mapped for longer than a frame or two.
+/// \param indexBuffer The index buffer to copy data to
+/// \return A pointer to memory that is pre-allocated to indexCount uint16_t or uint32_t
+void * IndexBufferMapIndices(IndexBuffer indexBuffer);
+
+/// Must be called after copying memory with IndexBufferMapIndices.
+/// It let's the gpu know that the memory isn't in use.
+/// \param indexBuffer The index buffer that had its indices mapped.
+void IndexBufferUnmapIndices(IndexBuffer indexBuffer);
+
+/// Pushes the memory staged in IndexBufferMapIndices to the GPU for use in rendering.
+/// The copy is recorded with every other upload of the frame and submitted right before the frame's commands.
+/// If the index buffer was created with optimize then the staged triangles are reordered first
+/// \param indexBuffer The index buffer to upload
+void IndexBufferUpload(IndexBuffer indexBuffer);
+
+/// Places the index buffer into a queue to be destroyed.
+/// This should only be called if the index buffer needs to be destroyed at render-time
+/// \param indexBuffer The index buffer to destroy
+void IndexBufferQueueDestroy(IndexBuffer indexBuffer);
+
+/// Destroys and frees the index buffer object
+/// Don't call this unless it's at the initialize or the deinitialize of the application, otherwise use IndexBufferQueueDestroy
+/// \param indexBuffer The index buffer to destroy
+void IndexBufferDestroy(IndexBuffer indexBuffer);
+
+#endif
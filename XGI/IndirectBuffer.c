@@ -0,0 +1,68 @@
+#include <stdlib.h>
+#include <vk_mem_alloc.h>
+#include "Graphics.h"
+#include "Transfer.h"
+#include "log.h"
+#include "IndirectBuffer.h"
+
+IndirectBuffer IndirectBufferCreate(int commandCount)
+{
+	IndirectBuffer indirectBuffer = malloc(sizeof(struct IndirectBuffer));
+	*indirectBuffer = (struct IndirectBuffer){ .CommandCount = commandCount };
+
+	size_t size = commandCount * sizeof(IndirectCommand);
+
+	VkBufferCreateInfo bufferInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = size,
+		.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+	};
+	VmaAllocationCreateInfo allocationInfo =
+	{
+		.usage = VMA_MEMORY_USAGE_GPU_ONLY,
+	};
+	vmaCreateBuffer(Graphics.Allocator, &bufferInfo, &allocationInfo, &indirectBuffer->Buffer, &indirectBuffer->Allocation, NULL);
+
+	return indirectBuffer;
+}
+
+IndirectCommand * IndirectBufferMapCommands(IndirectBuffer indirectBuffer)
+{
+	// The staging memory is only held from mapping until the upload is recorded
+	if (!indirectBuffer->Mapped)
+	{
+		indirectBuffer->Staging = TransferStagingAllocate(indirectBuffer->CommandCount * sizeof(IndirectCommand));
+		indirectBuffer->Mapped = true;
+	}
+	return indirectBuffer->Staging.Data;
+}
+
+void IndirectBufferUnmapCommands(IndirectBuffer indirectBuffer)
+{
+	// The staging ring is persistently mapped, the region is released once the upload is recorded
+}
+
+void IndirectBufferUpload(IndirectBuffer indirectBuffer)
+{
+	if (!indirectBuffer->Mapped)
+	{
+		log_warn("IndirectBuffer was uploaded without being mapped, there is nothing to upload\n");
+		return;
+	}
+	TransferUploadBuffer(indirectBuffer->Buffer, indirectBuffer->Staging, indirectBuffer->CommandCount * sizeof(IndirectCommand), &indirectBuffer->UploadSequence);
+	indirectBuffer->Mapped = false;
+}
+
+void IndirectBufferQueueDestroy(IndirectBuffer indirectBuffer)
+{
+	GraphicsQueueDestroy(GraphicsDestroyTypeIndirectBuffer, indirectBuffer);
+}
+
+void IndirectBufferDestroy(IndirectBuffer indirectBuffer)
+{
+	if (indirectBuffer->Mapped) { TransferStagingRelease(indirectBuffer->Staging); }
+	vmaDestroyBuffer(Graphics.Allocator, indirectBuffer->Buffer, indirectBuffer->Allocation);
+	free(indirectBuffer);
+}
@@ -0,0 +1,66 @@
+#ifndef IndirectBuffer_h
+#define IndirectBuffer_h
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include "Transfer.h"
+
+/// A single indexed draw, it has the same layout as VkDrawIndexedIndirectCommand
+typedef struct IndirectCommand
+{
+	/// The number of indices to draw
+	unsigned int IndexCount;
+	/// The number of instances to draw
+	unsigned int InstanceCount;
+	/// The first index to draw
+	unsigned int FirstIndex;
+	/// The value added to each index before reading the vertex
+	int VertexOffset;
+	/// The instance id of the first instance
+	unsigned int FirstInstance;
+} IndirectCommand;
+
+typedef struct IndirectBuffer
+{
+	int CommandCount;
+	TransferStaging Staging;
+	bool Mapped;
+	VkBuffer Buffer;
+	VmaAllocation Allocation;
+	unsigned long long UploadSequence;
+} * IndirectBuffer;
+
+/// Creates a buffer of draw commands used for GraphicsRenderIndirect.
+/// The buffer is also usable as a storage buffer so that shaders can fill it on the gpu
+/// \param commandCount The number of draw commands to allocate
+/// \return The newly created indirect buffer
+IndirectBuffer IndirectBufferCreate(int commandCount);
+
+/// Allows for copying draw commands into an indirect buffer.
+/// This function only stages the memory onto the cpu, call IndirectBufferUpload for it to be visible on the gpu.
+/// The memory comes from the staging ring and isn't kept after uploading, so every command must be written each time.
+/// The staging memory is held until the upload, so a buffer shouldn't stay mapped for longer than a frame or two.
+/// \param indirectBuffer The indirect buffer to copy commands to
+/// \return A pointer to commandCount draw commands
+IndirectCommand * IndirectBufferMapCommands(IndirectBuffer indirectBuffer);
+
+/// Must be called after copying memory with IndirectBufferMapCommands.
+/// \param indirectBuffer The indirect buffer that had its commands mapped.
+void IndirectBufferUnmapCommands(IndirectBuffer indirectBuffer);
+
+/// Pushes the commands staged in IndirectBufferMapCommands to the GPU.
+/// The copy is recorded with every other upload of the frame and submitted right before the frame's commands.
+/// \param indirectBuffer The indirect buffer to upload
+void IndirectBufferUpload(IndirectBuffer indirectBuffer);
+
+/// Places the indirect buffer into a queue to be destroyed.
+/// This should only be called if the indirect buffer needs to be destroyed at render-time
+/// \param indirectBuffer The indirect buffer to destroy
+void IndirectBufferQueueDestroy(IndirectBuffer indirectBuffer);
+
+/// Destroys and frees the indirect buffer object
+/// Don't call this unless it's at the initialize or the deinitialize of the application, otherwise use IndirectBufferQueueDestroy
+/// \param indirectBuffer The indirect buffer to destroy
+void IndirectBufferDestroy(IndirectBuffer indirectBuffer);
+
+#endif
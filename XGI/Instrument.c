@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Instrument.h"
+#include "List.h"
+#include "log.h"
+
+// A power of two so that ring indices stay continuous when the unsigned counters wrap around
+#define InstrumentRingCapacity 4096
+#define InstrumentMaxDepth 32
+
+struct InstrumentEvent
+{
+	const char * Name;
+	Uint64 Begin;
+	Uint64 End;
+};
+
+// Each thread writes finished sections into its own ring, only InstrumentNextFrame reads them
+struct InstrumentThread
+{
+	struct
+	{
+		const char * Name;
+		Uint64 Begin;
+	} Stack[InstrumentMaxDepth];
+	int Depth;
+	struct InstrumentEvent Events[InstrumentRingCapacity];
+	// Counts of written and read events, they're read as unsigned and index the ring modulo its capacity
+	SDL_atomic_t Write;
+	SDL_atomic_t Read;
+	SDL_atomic_t Dropped;
+};
+
+static struct Instrument
+{
+	bool Initialized;
+	SDL_TLSID ThreadKey;
+	SDL_mutex * Mutex;
+	List Threads;
+	double TicksPerMillisecond;
+	Uint64 FrameStart;
+	SDL_atomic_t VulkanCalls;
+	InstrumentFrameReport Report;
+} Instrument = { 0 };
+
+void InstrumentInitialize()
+{
+	Instrument.ThreadKey = SDL_TLSCreate();
+	Instrument.Mutex = SDL_CreateMutex();
+	Instrument.Threads = ListCreate();
+	Instrument.TicksPerMillisecond = SDL_GetPerformanceFrequency() / 1000.0;
+	Instrument.FrameStart = SDL_GetPerformanceCounter();
+	SDL_AtomicSet(&Instrument.VulkanCalls, 0);
+	Instrument.Report = (InstrumentFrameReport){ 0 };
+	Instrument.Initialized = true;
+}
+
+static struct InstrumentThread * GetThread()
+{
+	struct InstrumentThread * thread = SDL_TLSGet(Instrument.ThreadKey);
+	if (thread == NULL)
+	{
+		thread = calloc(1, sizeof(struct InstrumentThread));
+		SDL_TLSSet(Instrument.ThreadKey, thread, NULL);
+		SDL_LockMutex(Instrument.Mutex);
+		ListPush(Instrument.Threads, thread);
+		SDL_UnlockMutex(Instrument.Mutex);
+	}
+	return thread;
+}
+
+void InstrumentBegin(const char * name)
+{
+	if (!Instrument.Initialized) { return; }
+	struct InstrumentThread * thread = GetThread();
+	if (thread->Depth < InstrumentMaxDepth)
+	{
+		thread->Stack[thread->Depth].Name = name;
+		thread->Stack[thread->Depth].Begin = SDL_GetPerformanceCounter();
+	}
+	thread->Depth++;
+}
+
+void InstrumentEnd()
+{
+	if (!Instrument.Initialized) { return; }
+	Uint64 end = SDL_GetPerformanceCounter();
+	struct InstrumentThread * thread = GetThread();
+	if (thread->Depth == 0) { return; }
+	thread->Depth--;
+	if (thread->Depth >= InstrumentMaxDepth) { return; }
+
+	unsigned int write = (unsigned int)SDL_AtomicGet(&thread->Write);
+	if (write - (unsigned int)SDL_AtomicGet(&thread->Read) >= InstrumentRingCapacity)
+	{
+		SDL_AtomicAdd(&thread->Dropped, 1);
+		return;
+	}
+	thread->Events[write % InstrumentRingCapacity] = (struct InstrumentEvent)
+	{
+		.Name = thread->Stack[thread->Depth].Name,
+		.Begin = thread->Stack[thread->Depth].Begin,
+		.End = end,
+	};
+	SDL_AtomicSet(&thread->Write, (int)(write + 1));
+}
+
+void InstrumentCountVulkanCalls(int count)
+{
+	SDL_AtomicAdd(&Instrument.VulkanCalls, count);
+}
+
+static void AddTiming(InstrumentFrameReport * report, const char * name, double milliseconds)
+{
+	for (int i = 0; i < report->TimingCount; i++)
+	{
+		if (report->Timings[i].Name == name || strcmp(report->Timings[i].Name, name) == 0)
+		{
+			report->Timings[i].Milliseconds += milliseconds;
+			report->Timings[i].Calls++;
+			return;
+		}
+	}
+	if (report->TimingCount == InstrumentMaxTimings) { return; }
+	report->Timings[report->TimingCount++] = (InstrumentTiming){ .Name = name, .Milliseconds = milliseconds, .Calls = 1 };
+}
+
+void InstrumentNextFrame()
+{
+	if (!Instrument.Initialized) { return; }
+	Uint64 now = SDL_GetPerformanceCounter();
+	InstrumentFrameReport * report = &Instrument.Report;
+	*report = (InstrumentFrameReport)
+	{
+		.Milliseconds = (now - Instrument.FrameStart) / Instrument.TicksPerMillisecond,
+		.VulkanCalls = SDL_AtomicSet(&Instrument.VulkanCalls, 0),
+	};
+	Instrument.FrameStart = now;
+
+	SDL_LockMutex(Instrument.Mutex);
+	for (int i = 0; i < ListGetCount(Instrument.Threads); i++)
+	{
+		struct InstrumentThread * thread = ListGetValue(Instrument.Threads, i);
+		unsigned int write = (unsigned int)SDL_AtomicGet(&thread->Write);
+		for (unsigned int j = (unsigned int)SDL_AtomicGet(&thread->Read); j != write; j++)
+		{
+			struct InstrumentEvent * event = thread->Events + j % InstrumentRingCapacity;
+			AddTiming(report, event->Name, (event->End - event->Begin) / Instrument.TicksPerMillisecond);
+		}
+		SDL_AtomicSet(&thread->Read, (int)write);
+		report->DroppedEvents += SDL_AtomicSet(&thread->Dropped, 0);
+	}
+	SDL_UnlockMutex(Instrument.Mutex);
+}
+
+InstrumentFrameReport InstrumentGetFrameReport()
+{
+	return Instrument.Report;
+}
+
+void InstrumentLogFrameReport()
+{
+	InstrumentFrameReport * report = &Instrument.Report;
+	log_info("Frame: %.3fms, %i vulkan calls\n", report->Milliseconds, report->VulkanCalls);
+	for (int i = 0; i < report->TimingCount; i++)
+	{
+		log_info("  %s: %.3fms (%i calls)\n", report->Timings[i].Name, report->Timings[i].Milliseconds, report->Timings[i].Calls);
+	}
+	if (report->DroppedEvents > 0) { log_warn("  %i sections were dropped\n", report->DroppedEvents); }
+}
+
+void InstrumentDeinitialize()
+{
+	if (!Instrument.Initialized) { return; }
+	Instrument.Initialized = false;
+	for (int i = 0; i < ListGetCount(Instrument.Threads); i++) { free(ListGetValue(Instrument.Threads, i)); }
+	ListDestroy(Instrument.Threads);
+	SDL_DestroyMutex(Instrument.Mutex);
+}
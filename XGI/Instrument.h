@@ -0,0 +1,78 @@
+#ifndef Instrument_h
+#define Instrument_h
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// Instrumentation is compiled in for debug builds, define XGI_INSTRUMENT to keep it in release builds
+#if !defined(XGI_INSTRUMENT) && !defined(NDEBUG)
+#define XGI_INSTRUMENT
+#endif
+
+#ifdef XGI_INSTRUMENT
+#define INSTRUMENT_BEGIN(name) InstrumentBegin(name)
+#define INSTRUMENT_END() InstrumentEnd()
+#define INSTRUMENT_VULKAN_CALLS(count) InstrumentCountVulkanCalls(count)
+#define INSTRUMENT_NEXT_FRAME() InstrumentNextFrame()
+#else
+#define INSTRUMENT_BEGIN(name) ((void)0)
+#define INSTRUMENT_END() ((void)0)
+#define INSTRUMENT_VULKAN_CALLS(count) ((void)0)
+#define INSTRUMENT_NEXT_FRAME() ((void)0)
+#endif
+
+#define InstrumentMaxTimings 64
+
+/// The cpu time spent in one named section during a frame
+typedef struct InstrumentTiming
+{
+	const char * Name;
+	/// The total time spent in the section in milliseconds, nested sections are included
+	double Milliseconds;
+	/// The number of times the section was entered
+	int Calls;
+} InstrumentTiming;
+
+/// The breakdown of a whole frame
+typedef struct InstrumentFrameReport
+{
+	/// The time between the start of the frame and the start of the next one in milliseconds
+	double Milliseconds;
+	/// The number of vulkan functions called during the frame
+	int VulkanCalls;
+	/// The number of sections that were dropped because a thread's event ring was full
+	int DroppedEvents;
+	int TimingCount;
+	InstrumentTiming Timings[InstrumentMaxTimings];
+} InstrumentFrameReport;
+
+/// This should not be called by the user, it is called in the XGIInitialize function
+void InstrumentInitialize(void);
+
+/// Starts timing a section on the calling thread, sections can be nested.
+/// Use the INSTRUMENT_BEGIN macro so that it is compiled out of release builds
+/// \param name The name of the section, the string must stay valid for the lifetime of the program
+void InstrumentBegin(const char * name);
+
+/// Stops timing the most recently started section on the calling thread
+void InstrumentEnd(void);
+
+/// Adds to the number of vulkan functions called this frame, it can be called from any thread
+/// \param count The number of calls to add
+void InstrumentCountVulkanCalls(int count);
+
+/// Ends the current frame and gathers the sections recorded by every thread into its report.
+/// This is called at the end of GraphicsPresent
+void InstrumentNextFrame(void);
+
+/// Gets the breakdown of the most recently finished frame
+/// \return The frame report
+InstrumentFrameReport InstrumentGetFrameReport(void);
+
+/// Writes the breakdown of the most recently finished frame to the log
+void InstrumentLogFrameReport(void);
+
+/// This should not be called by the user, it is called in the XGIDeinitialize function
+void InstrumentDeinitialize(void);
+
+#endif
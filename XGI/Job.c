@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "Job.h"
+#include "log.h"
+
+static struct JobSystem
+{
+	SDL_Thread ** Threads;
+	int ThreadCount;
+	SDL_mutex * Mutex;
+	SDL_cond * WorkAvailable;
+	SDL_cond * WorkDone;
+	Job Head;
+	Job Tail;
+	bool Running;
+} JobSystem = { 0 };
+
+// The mutex must be locked when calling this
+static Job PopJob()
+{
+	Job job = JobSystem.Head;
+	if (job != NULL)
+	{
+		JobSystem.Head = job->Next;
+		if (JobSystem.Head == NULL) { JobSystem.Tail = NULL; }
+	}
+	return job;
+}
+
+static void RunJob(Job job)
+{
+	job->Function(job->Data);
+	SDL_LockMutex(JobSystem.Mutex);
+	SDL_AtomicSet(&job->Done, 1);
+	SDL_CondBroadcast(JobSystem.WorkDone);
+	SDL_UnlockMutex(JobSystem.Mutex);
+}
+
+static int WorkerThread(void * data)
+{
+	SDL_LockMutex(JobSystem.Mutex);
+	while (true)
+	{
+		while (JobSystem.Head == NULL && JobSystem.Running) { SDL_CondWait(JobSystem.WorkAvailable, JobSystem.Mutex); }
+		Job job = PopJob();
+		if (job == NULL) { break; }
+		SDL_UnlockMutex(JobSystem.Mutex);
+		RunJob(job);
+		SDL_LockMutex(JobSystem.Mutex);
+	}
+	SDL_UnlockMutex(JobSystem.Mutex);
+	return 0;
+}
+
+void JobSystemInitialize(int threadCount)
+{
+	if (threadCount <= 0) { threadCount = SDL_GetCPUCount() - 1; }
+	JobSystem = (struct JobSystem)
+	{
+		.ThreadCount = threadCount,
+		.Running = true,
+	};
+	if (threadCount <= 0)
+	{
+		JobSystem.ThreadCount = 0;
+		return;
+	}
+
+	JobSystem.Mutex = SDL_CreateMutex();
+	JobSystem.WorkAvailable = SDL_CreateCond();
+	JobSystem.WorkDone = SDL_CreateCond();
+	JobSystem.Threads = malloc(threadCount * sizeof(SDL_Thread *));
+	for (int i = 0; i < threadCount; i++)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "XGI Worker %i", i);
+		JobSystem.Threads[i] = SDL_CreateThread(WorkerThread, name, NULL);
+		if (JobSystem.Threads[i] == NULL)
+		{
+			log_fatal("Failed to create worker thread: %s\n", SDL_GetError());
+			exit(1);
+		}
+	}
+	log_info("Created %i worker threads\n", threadCount);
+}
+
+int JobSystemGetThreadCount()
+{
+	return JobSystem.ThreadCount;
+}
+
+void JobStart(Job job, void (*function)(void * data), void * data)
+{
+	*job = (struct Job)
+	{
+		.Function = function,
+		.Data = data,
+		.Next = NULL,
+	};
+	SDL_AtomicSet(&job->Done, 0);
+	if (JobSystem.ThreadCount == 0)
+	{
+		function(data);
+		SDL_AtomicSet(&job->Done, 1);
+		return;
+	}
+
+	SDL_LockMutex(JobSystem.Mutex);
+	if (JobSystem.Tail == NULL) { JobSystem.Head = job; }
+	else { JobSystem.Tail->Next = job; }
+	JobSystem.Tail = job;
+	SDL_CondSignal(JobSystem.WorkAvailable);
+	SDL_UnlockMutex(JobSystem.Mutex);
+}
+
+Job JobSubmit(void (*function)(void * data), void * data)
+{
+	Job job = malloc(sizeof(struct Job));
+	JobStart(job, function, data);
+	return job;
+}
+
+bool JobIsDone(Job job)
+{
+	return SDL_AtomicGet(&job->Done) != 0;
+}
+
+void JobWait(Job job)
+{
+	if (JobIsDone(job)) { return; }
+	SDL_LockMutex(JobSystem.Mutex);
+	while (!JobIsDone(job))
+	{
+		Job queued = PopJob();
+		if (queued != NULL)
+		{
+			SDL_UnlockMutex(JobSystem.Mutex);
+			RunJob(queued);
+			SDL_LockMutex(JobSystem.Mutex);
+		}
+		else { SDL_CondWait(JobSystem.WorkDone, JobSystem.Mutex); }
+	}
+	SDL_UnlockMutex(JobSystem.Mutex);
+}
+
+void JobDestroy(Job job)
+{
+	JobWait(job);
+	free(job);
+}
+
+void JobSystemDeinitialize()
+{
+	if (JobSystem.ThreadCount == 0) { return; }
+	SDL_LockMutex(JobSystem.Mutex);
+	JobSystem.Running = false;
+	SDL_CondBroadcast(JobSystem.WorkAvailable);
+	SDL_UnlockMutex(JobSystem.Mutex);
+	for (int i = 0; i < JobSystem.ThreadCount; i++)
+	{
+		SDL_WaitThread(JobSystem.Threads[i], NULL);
+	}
+	free(JobSystem.Threads);
+	SDL_DestroyCond(JobSystem.WorkDone);
+	SDL_DestroyCond(JobSystem.WorkAvailable);
+	SDL_DestroyMutex(JobSystem.Mutex);
+	JobSystem = (struct JobSystem){ 0 };
+}
@@ -0,0 +1,56 @@
+#ifndef Job_h
+#define Job_h
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+/// A unit of work that runs on one of the worker threads
+typedef struct Job
+{
+	void (*Function)(void * data);
+	void * Data;
+	SDL_atomic_t Done;
+	struct Job * Next;
+} * Job;
+
+/// This should not be called by the user, it is called in the XGIInitialize function
+/// \param threadCount The number of worker threads to create, 0 creates one less than the number of cores
+void JobSystemInitialize(int threadCount);
+
+/// Gets the number of worker threads
+/// \return The number of worker threads (0 if jobs run on the calling thread)
+int JobSystemGetThreadCount(void);
+
+/// Queues a function to run on a worker thread.
+/// If there are no worker threads then the function is run before returning
+/// \param function The function to run
+/// \param data The pointer that is passed to the function
+/// \return The job object, it must be destroyed with JobDestroy
+Job JobSubmit(void (*function)(void * data), void * data);
+
+/// Queues a function to run on a worker thread using job storage owned by the caller, so that nothing is allocated.
+/// If there are no worker threads then the function is run before returning
+/// \param job The storage for the job, it must stay valid until JobWait returns and isn't given to JobDestroy
+/// \param function The function to run
+/// \param data The pointer that is passed to the function
+void JobStart(Job job, void (*function)(void * data), void * data);
+
+/// Checks if a job has finished running without blocking
+/// \param job The job to check
+/// \return Whether or not the job has finished
+bool JobIsDone(Job job);
+
+/// Blocks until a job has finished running.
+/// The calling thread helps with queued jobs while it waits
+/// \param job The job to wait for
+void JobWait(Job job);
+
+/// Waits for a job to finish then frees it
+/// \param job The job to destroy
+void JobDestroy(Job job);
+
+/// This should not be called by the user, it is called in the XGIDeinitialize function.
+/// All of the queued jobs are finished before the worker threads exit
+void JobSystemDeinitialize(void);
+
+#endif
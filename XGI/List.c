@@ -112,10 +112,7 @@ bool ListContains(List list, void * value)
 
 void ListClear(List list)
 {
-	for (int i = list->Count - 1; i >= 0; i--)
-	{
-		ListOutsert(list, i);
-	}
+	list->Count = 0;
 }
 
 void ListDestroy(List list)
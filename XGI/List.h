@@ -73,7 +73,8 @@ void ListSetIndex(List list, int index, void * value);
 /// \return Whether or not the list contains that value
 bool ListContains(List list, void * value);
 
-/// Removes all values from a list
+/// Removes all values from a list.
+/// The allocated capacity is kept so the list can be refilled without allocating
 /// \param list The list to clear
 void ListClear(List list);
 
@@ -3,31 +3,101 @@
 #include <stdio.h>
 #include <shaderc/shaderc.h>
 #include <spirv/spirv_reflect.h>
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_mutex.h>
 #include "Pipeline.h"
 #include "Graphics.h"
 #include "UniformBuffer.h"
+#include "Bindless.h"
 #include "File.h"
+#include "Job.h"
+#include "List.h"
 #include "log.h"
 
-ShaderData ShaderDataFromMemory(ShaderType type, unsigned long dataSize, void * data, bool precompiled)
+static unsigned long long HashShader(shaderc_shader_kind kind, unsigned long size, const char * text)
 {
-	if (!precompiled)
+	// 64 bit FNV-1a over everything that affects the compiled output
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	const char * version = "XGI-SPIRV-1:main";
+	for (const char * c = version; *c != '\0'; c++) { hash = (hash ^ (unsigned char)*c) * 0x100000001b3ULL; }
+	hash = (hash ^ (unsigned long long)kind) * 0x100000001b3ULL;
+	hash = (hash ^ (unsigned long long)size) * 0x100000001b3ULL;
+	for (unsigned long i = 0; i < size; i++) { hash = (hash ^ (unsigned char)text[i]) * 0x100000001b3ULL; }
+	return hash;
+}
+
+static void WriteShaderCache(const char * path, unsigned long size, const void * data)
+{
+	char temporaryPath[1024];
+	snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path);
+	File file = FileTryOpen(temporaryPath, FileModeWriteBinary);
+	if (file == NULL)
+	{
+		log_warn("Unable to write to the shader cache: %s\n", path);
+		return;
+	}
+	FileWrite(file, 0, size, (void *)data);
+	FileClose(file);
+	if (rename(temporaryPath, path) != 0) { remove(temporaryPath); }
+}
+
+static ShaderData CompileShader(ShaderType type, unsigned long size, const char * text, const char * name)
+{
+	shaderc_shader_kind shaderType = type == ShaderTypeVertex ? shaderc_vertex_shader : shaderc_fragment_shader;
+	char cachePath[1024];
+	if (Graphics.ShaderCachePath != NULL)
 	{
-		shaderc_shader_kind shaderType = type == ShaderTypeVertex ? shaderc_vertex_shader : shaderc_fragment_shader;
-		shaderc_compilation_result_t result = shaderc_compile_into_spv(Graphics.ShaderCompiler, data, dataSize, shaderType, "shader", "main", 0);
-		if (shaderc_result_get_num_errors(result) > 0)
+		snprintf(cachePath, sizeof(cachePath), "%s/%016llx.spv", Graphics.ShaderCachePath, HashShader(shaderType, size, text));
+		unsigned long cachedSize;
+		unsigned int * cached = FileMap(cachePath, &cachedSize);
+		if (cached != NULL)
 		{
-			log_fatal("Error while compiling shader:\n%s\n", shaderc_result_get_error_message(result));
-			exit(1);
+			if (cachedSize % 4 == 0 && cached[0] == SpvMagicNumber)
+			{
+				SDL_AtomicAdd(&Graphics.Statistics.ShaderCacheHits, 1);
+				return (ShaderData)
+				{
+					.Type = type,
+					.DataSize = cachedSize,
+					.Data = cached,
+					.Storage = ShaderDataStorageMapped,
+				};
+			}
+			FileUnmap(cached, cachedSize);
 		}
-		data = (void *)shaderc_result_get_bytes(result);
-		dataSize = shaderc_result_get_length(result);
 	}
+	
+	shaderc_compilation_result_t result = shaderc_compile_into_spv(Graphics.ShaderCompiler, text, size, shaderType, name, "main", 0);
+	if (shaderc_result_get_num_errors(result) > 0)
+	{
+		log_fatal("Error while compiling shader:\n%s\n", shaderc_result_get_error_message(result));
+		exit(1);
+	}
+	unsigned long dataSize = shaderc_result_get_length(result);
+	void * data = malloc(dataSize);
+	memcpy(data, shaderc_result_get_bytes(result), dataSize);
+	shaderc_result_release(result);
+	
+	SDL_AtomicAdd(&Graphics.Statistics.ShaderCacheMisses, 1);
+	if (Graphics.ShaderCachePath != NULL) { WriteShaderCache(cachePath, dataSize, data); }
 	return (ShaderData)
 	{
 		.Type = type,
 		.DataSize = dataSize,
 		.Data = data,
+		.Storage = ShaderDataStorageHeap,
+	};
+}
+
+ShaderData ShaderDataFromMemory(ShaderType type, unsigned long dataSize, void * data, bool precompiled)
+{
+	if (!precompiled) { return CompileShader(type, dataSize, data, "shader"); }
+	return (ShaderData)
+	{
+		.Type = type,
+		.DataSize = dataSize,
+		.Data = data,
+		.Storage = ShaderDataStorageUser,
 	};
 }
 
@@ -40,21 +110,9 @@ ShaderData ShaderDataFromFile(ShaderType type, const char * file, bool precompil
 		char * text = malloc(size);
 		FileRead(shader, 0, size, text);
 		FileClose(shader);
-		shaderc_shader_kind shaderType = type == ShaderTypeVertex ? shaderc_vertex_shader : shaderc_fragment_shader;
-		shaderc_compilation_result_t result = shaderc_compile_into_spv(Graphics.ShaderCompiler, text, size, shaderType, file, "main", 0);
-		if (shaderc_result_get_num_errors(result) > 0)
-		{
-			log_fatal("Error while compiling shader:\n%s\n", shaderc_result_get_error_message(result));
-			exit(1);
-		}
-		void * data = (void *)shaderc_result_get_bytes(result);
-		unsigned long dataSize = shaderc_result_get_length(result);
-		return (ShaderData)
-		{
-			.Type = type,
-			.DataSize = dataSize,
-			.Data = data,
-		};
+		ShaderData data = CompileShader(type, size, text, file);
+		free(text);
+		return data;
 	}
 	File spv = FileOpen(file, FileModeReadBinary);
 	unsigned long size = FileGetSize(spv);
@@ -66,9 +124,46 @@ ShaderData ShaderDataFromFile(ShaderType type, const char * file, bool precompil
 		.Type = type,
 		.DataSize = size,
 		.Data = data,
+		.Storage = ShaderDataStorageHeap,
 	};
 }
 
+typedef struct ShaderLoad
+{
+	ShaderType Type;
+	const char * File;
+	bool Precompiled;
+	ShaderData * Data;
+} ShaderLoad;
+
+static void LoadShaderJob(void * data)
+{
+	ShaderLoad * load = data;
+	*load->Data = ShaderDataFromFile(load->Type, load->File, load->Precompiled);
+}
+
+void ShaderDataFromFiles(const ShaderType * types, const char ** files, int count, bool precompiled, ShaderData * data)
+{
+	// The shaderc compiler can be used from several threads at once
+	ShaderLoad * loads = malloc(count * sizeof(ShaderLoad));
+	Job * jobs = malloc(count * sizeof(Job));
+	for (int i = 0; i < count; i++)
+	{
+		loads[i] = (ShaderLoad){ .Type = types[i], .File = files[i], .Precompiled = precompiled, .Data = &data[i] };
+		jobs[i] = JobSubmit(LoadShaderJob, &loads[i]);
+	}
+	// The calling thread compiles queued shaders while it waits
+	for (int i = 0; i < count; i++) { JobDestroy(jobs[i]); }
+	free(jobs);
+	free(loads);
+}
+
+void ShaderDataDestroy(ShaderData data)
+{
+	if (data.Storage == ShaderDataStorageHeap) { free(data.Data); }
+	else if (data.Storage == ShaderDataStorageMapped) { FileUnmap(data.Data, data.DataSize); }
+}
+
 static void CreateReflectModules(Pipeline pipeline, PipelineConfigure config)
 {
 	pipeline->StageCount = config.ShaderCount;
@@ -94,6 +189,7 @@ static VkPushConstantRange GetPushConstantRange(Pipeline pipeline)
 		{
 			pipeline->UsesPushConstant = true;
 			pipeline->PushConstantInfo = pushConstants[0];
+			pipeline->PushConstantVariables = ShaderVariableTableCreate(pushConstants[0]);
 			pipeline->PushConstantData = malloc(pushConstants[0].size);
 			pipeline->PushConstantSize = pushConstants[0].size;
 			return (VkPushConstantRange)
@@ -107,157 +203,363 @@ static VkPushConstantRange GetPushConstantRange(Pipeline pipeline)
 	return pushConstantRange;
 }
 
-static void CreateDescriptorLayout(Pipeline pipeline, int * uboCount, int * samplerCount)
+// Pipelines whose shaders reflect the same bindings and push constant range share one layout
+// A mutex rather than a spinlock since layouts are created while it's held, which can take a while in the driver
+static struct PipelineLayoutCache
+{
+	SDL_mutex * Mutex;
+	List Layouts;
+} LayoutCache = { 0 };
+
+// The pipelines with uniform buffers, their descriptors are written again when a frame's uniform ring is replaced
+static struct PipelineUniformRegistry
+{
+	SDL_SpinLock Lock;
+	List Pipelines;
+} UniformRegistry = { 0 };
+
+static int CompareDynamicUniforms(const void * a, const void * b)
+{
+	const struct PipelineDynamicUniform * uniformA = a;
+	const struct PipelineDynamicUniform * uniformB = b;
+	if (uniformA->Binding != uniformB->Binding) { return uniformA->Binding < uniformB->Binding ? -1 : 1; }
+	if (uniformA->ArrayElement != uniformB->ArrayElement) { return uniformA->ArrayElement < uniformB->ArrayElement ? -1 : 1; }
+	return 0;
+}
+
+// Dynamic offsets are given to vkCmdBindDescriptorSets in binding order, then array element order
+static void CreateDynamicUniforms(Pipeline pipeline, PipelineSharedLayout layout)
+{
+	int count = 0;
+	for (int i = 0; i < layout->BindingCount; i++)
+	{
+		if (layout->Bindings[i].descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) { count += layout->Bindings[i].descriptorCount; }
+	}
+	pipeline->DynamicUniforms = malloc(MAX(count, 1) * sizeof(struct PipelineDynamicUniform));
+	pipeline->DynamicUniformCount = 0;
+	for (int i = 0; i < layout->BindingCount; i++)
+	{
+		if (layout->Bindings[i].descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) { continue; }
+		for (int j = 0; j < layout->Bindings[i].descriptorCount; j++)
+		{
+			pipeline->DynamicUniforms[pipeline->DynamicUniformCount++] = (struct PipelineDynamicUniform)
+			{
+				.Binding = layout->Bindings[i].binding,
+				.ArrayElement = j,
+				.Uniform = NULL,
+			};
+		}
+	}
+	qsort(pipeline->DynamicUniforms, pipeline->DynamicUniformCount, sizeof(struct PipelineDynamicUniform), CompareDynamicUniforms);
+}
+
+static int CompareBindings(const void * a, const void * b)
+{
+	const VkDescriptorSetLayoutBinding * bindingA = a;
+	const VkDescriptorSetLayoutBinding * bindingB = b;
+	if (bindingA->binding != bindingB->binding) { return bindingA->binding < bindingB->binding ? -1 : 1; }
+	return 0;
+}
+
+// Merges the set 0 bindings of every stage into one list sorted by binding number so that identical layouts always compare equal.
+// A binding declared by several stages becomes one binding visible to all of them
+static VkDescriptorSetLayoutBinding * GetDescriptorBindings(Pipeline pipeline, int * bindingCount)
 {
-	unsigned int bindingCount = 0;
-	pipeline->UsesDescriptors = false;
+	unsigned int totalCount = 0;
+	pipeline->UsesBindless = false;
 	for (int i = 0; i < pipeline->StageCount; i++)
 	{
 		struct PipelineStage * stage = pipeline->Stages + i;
-		unsigned int setCount;
-		spvReflectEnumerateDescriptorSets(&stage->Module, &setCount, NULL);
-		SpvReflectDescriptorSet * sets = malloc(setCount * sizeof(SpvReflectDescriptorSet));
-		spvReflectEnumerateDescriptorSets(&stage->Module, &setCount, &sets);
+		// Set 0 holds the pipeline's own bindings, the texture table's set is shared by every pipeline
+		const SpvReflectDescriptorSet * set = spvReflectGetDescriptorSet(&stage->Module, 0, NULL);
+		pipeline->UsesBindless |= spvReflectGetDescriptorSet(&stage->Module, BindlessSet, NULL) != NULL;
 		
 		stage->BindingCount = 0;
-		if (setCount > 0)
+		if (set != NULL)
 		{
-			pipeline->UsesDescriptors = true;
-			stage->DescriptorInfo = sets[0];
+			stage->DescriptorInfo = *set;
 			stage->BindingCount = stage->DescriptorInfo.binding_count;
-			bindingCount += stage->DescriptorInfo.binding_count;
+			totalCount += stage->DescriptorInfo.binding_count;
 		}
 	}
-	if (pipeline->UsesDescriptors)
+	if (pipeline->UsesBindless && BindlessGetSet() == VK_NULL_HANDLE)
+	{
+		log_fatal("A shader uses the bindless texture table at set %i but the device doesn't support descriptor indexing\n", BindlessSet);
+		exit(1);
+	}
+	
+	VkDescriptorSetLayoutBinding * bindings = malloc(MAX(totalCount, 1) * sizeof(VkDescriptorSetLayoutBinding));
+	*bindingCount = 0;
+	for (int i = 0; i < pipeline->StageCount; i++)
 	{
-		VkDescriptorSetLayoutBinding * layoutBindings = malloc(bindingCount * sizeof(VkDescriptorSetLayoutBinding));
-		for (int i = 0, c = 0; i < pipeline->StageCount; i++)
+		struct PipelineStage * stage = pipeline->Stages + i;
+		for (int j = 0; j < stage->BindingCount; j++)
 		{
-			struct PipelineStage * stage = pipeline->Stages + i;
-			unsigned int setCount;
-			spvReflectEnumerateDescriptorSets(&stage->Module, &setCount, NULL);
-			SpvReflectDescriptorSet* sets = malloc(setCount * sizeof(SpvReflectDescriptorSet));
-			spvReflectEnumerateDescriptorSets(&stage->Module, &setCount, &sets);
-
-			if (setCount > 0)
+			SpvReflectDescriptorBinding * binding = stage->DescriptorInfo.bindings[j];
+			VkDescriptorType type = (VkDescriptorType)binding->descriptor_type;
+			// Uniform buffers are sub-allocated from the frame's uniform ring on every draw
+			if (type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) { type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; }
+			
+			VkDescriptorSetLayoutBinding * existing = NULL;
+			for (int k = 0; k < *bindingCount; k++)
+			{
+				if (bindings[k].binding == binding->binding) { existing = bindings + k; }
+			}
+			if (existing == NULL)
 			{
-				for (int j = 0; j < stage->DescriptorInfo.binding_count; j++, c++)
+				bindings[(*bindingCount)++] = (VkDescriptorSetLayoutBinding)
 				{
-					SpvReflectDescriptorBinding * binding = stage->DescriptorInfo.bindings[j];
-					layoutBindings[c] = (VkDescriptorSetLayoutBinding)
-					{
-						.binding = binding->binding,
-						.descriptorCount = binding->count,
-						.descriptorType = (VkDescriptorType)binding->descriptor_type,
-						.stageFlags = stage->ShaderType,
-					};
-					if (binding->descriptor_type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) { (*samplerCount) += binding->count; }
-					if (binding->descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) { (*uboCount) += binding->count; }
-				}
+					.binding = binding->binding,
+					.descriptorCount = binding->count,
+					.descriptorType = type,
+					.stageFlags = stage->ShaderType,
+				};
+				continue;
 			}
+			if (existing->descriptorType != type || existing->descriptorCount != binding->count)
+			{
+				log_fatal("Binding %i is declared differently in two shader stages\n", binding->binding);
+				exit(1);
+			}
+			existing->stageFlags |= stage->ShaderType;
 		}
+	}
+	qsort(bindings, *bindingCount, sizeof(VkDescriptorSetLayoutBinding), CompareBindings);
+	return bindings;
+}
 
-		VkDescriptorSetLayoutCreateInfo layoutInfo =
-		{
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-			.bindingCount = bindingCount,
-			.pBindings = layoutBindings,
-		};
-		vkCreateDescriptorSetLayout(Graphics.Device, &layoutInfo, NULL, &pipeline->DescriptorLayout);
-		free(layoutBindings);
+static unsigned long long HashValue(unsigned long long hash, unsigned int value)
+{
+	for (int i = 0; i < 4; i++) { hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 0x100000001b3ULL; }
+	return hash;
+}
+
+// 64 bit FNV-1a over everything that makes two layouts incompatible
+static unsigned long long HashLayout(const VkDescriptorSetLayoutBinding * bindings, int bindingCount, VkPushConstantRange pushConstantRange, bool usesBindless)
+{
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	for (int i = 0; i < bindingCount; i++)
+	{
+		hash = HashValue(hash, bindings[i].binding);
+		hash = HashValue(hash, bindings[i].descriptorType);
+		hash = HashValue(hash, bindings[i].descriptorCount);
+		hash = HashValue(hash, bindings[i].stageFlags);
 	}
+	hash = HashValue(hash, pushConstantRange.stageFlags);
+	hash = HashValue(hash, pushConstantRange.offset);
+	hash = HashValue(hash, pushConstantRange.size);
+	return HashValue(hash, usesBindless);
 }
 
-static void CreateDescriptorPool(Pipeline pipeline, int uboCount, int samplerCount)
+static bool SameLayout(PipelineSharedLayout layout, const VkDescriptorSetLayoutBinding * bindings, int bindingCount, VkPushConstantRange pushConstantRange, bool usesBindless)
 {
-	if (pipeline->UsesDescriptors)
+	if (layout->BindingCount != bindingCount || layout->UsesBindless != usesBindless) { return false; }
+	if (layout->PushConstantRange.stageFlags != pushConstantRange.stageFlags || layout->PushConstantRange.offset != pushConstantRange.offset ||
+		layout->PushConstantRange.size != pushConstantRange.size) { return false; }
+	for (int i = 0; i < bindingCount; i++)
 	{
-		VkDescriptorPoolSize poolSizes[2];
-		int i = 0;
-		if (uboCount > 0)
-		{
-			poolSizes[i] = (VkDescriptorPoolSize)
-			{
-				.descriptorCount = uboCount * Graphics.FrameResourceCount,
-				.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			};
-			i++;
-		}
-		if (samplerCount > 0)
+		const VkDescriptorSetLayoutBinding * a = layout->Bindings + i;
+		const VkDescriptorSetLayoutBinding * b = bindings + i;
+		if (a->binding != b->binding || a->descriptorType != b->descriptorType || a->descriptorCount != b->descriptorCount || a->stageFlags != b->stageFlags) { return false; }
+	}
+	return true;
+}
+
+static void CreateDescriptorPool(Pipeline pipeline, PipelineSharedLayout layout)
+{
+	int uboCount = 0, samplerCount = 0;
+	for (int i = 0; i < layout->BindingCount; i++)
+	{
+		if (layout->Bindings[i].descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) { uboCount += layout->Bindings[i].descriptorCount; }
+		if (layout->Bindings[i].descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) { samplerCount += layout->Bindings[i].descriptorCount; }
+	}
+	VkDescriptorPoolSize poolSizes[2];
+	int i = 0;
+	if (uboCount > 0)
+	{
+		poolSizes[i] = (VkDescriptorPoolSize)
 		{
-			poolSizes[i] = (VkDescriptorPoolSize)
-			{
-				.descriptorCount = samplerCount * Graphics.FrameResourceCount,
-				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			};
-			i++;
-		}
-		VkDescriptorPoolCreateInfo poolInfo =
+			.descriptorCount = uboCount * Graphics.FrameResourceCount * 2,
+			.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		};
+		i++;
+	}
+	if (samplerCount > 0)
+	{
+		poolSizes[i] = (VkDescriptorPoolSize)
 		{
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-			.maxSets = Graphics.FrameResourceCount,
-			.poolSizeCount = i,
-			.pPoolSizes = poolSizes,
+			.descriptorCount = samplerCount * Graphics.FrameResourceCount * 2,
+			.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 		};
-		vkCreateDescriptorPool(Graphics.Device, &poolInfo, NULL, &pipeline->DescriptorPool);
+		i++;
 	}
+	VkDescriptorPoolCreateInfo poolInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.maxSets = Graphics.FrameResourceCount * 2,
+		.poolSizeCount = i,
+		.pPoolSizes = poolSizes,
+	};
+	vkCreateDescriptorPool(Graphics.Device, &poolInfo, NULL, &pipeline->DescriptorPool);
 }
 
-static void CreateDescriptorSets(Pipeline pipeline)
+// Every frame resource gets a set, and an overflow set for when its uniform ring fills up
+static void CreateDescriptorSets(Pipeline pipeline, PipelineSharedLayout layout)
 {
-	if (pipeline->UsesDescriptors)
+	pipeline->DescriptorSet = malloc(Graphics.FrameResourceCount * sizeof(VkDescriptorSet));
+	pipeline->OverflowDescriptorSet = malloc(Graphics.FrameResourceCount * sizeof(VkDescriptorSet));
+	pipeline->OverflowFrame = malloc(Graphics.FrameResourceCount * sizeof(int));
+	for (int i = 0; i < Graphics.FrameResourceCount; i++)
 	{
-		pipeline->DescriptorSet = malloc(Graphics.FrameResourceCount * sizeof(VkDescriptorSet));
-		for (int i = 0; i < Graphics.FrameResourceCount; i++)
+		VkDescriptorSetAllocateInfo allocateInfo =
 		{
-			VkDescriptorSetAllocateInfo allocateInfo =
-			{
-				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-				.descriptorPool = pipeline->DescriptorPool,
-				.descriptorSetCount = 1,
-				.pSetLayouts = &pipeline->DescriptorLayout,
-			};
-			vkAllocateDescriptorSets(Graphics.Device, &allocateInfo, pipeline->DescriptorSet + i);
-		}
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.descriptorPool = pipeline->DescriptorPool,
+			.descriptorSetCount = 1,
+			.pSetLayouts = &layout->DescriptorLayout,
+		};
+		vkAllocateDescriptorSets(Graphics.Device, &allocateInfo, pipeline->DescriptorSet + i);
+		vkAllocateDescriptorSets(Graphics.Device, &allocateInfo, pipeline->OverflowDescriptorSet + i);
+		pipeline->OverflowFrame[i] = -1;
 	}
 }
 
-static void CreatePipelineLayout(Pipeline pipeline, VkPushConstantRange pushConstantRange)
+static void CreatePipelineLayout(PipelineSharedLayout layout)
 {
+	bool usesDescriptors = layout->BindingCount > 0;
+	VkDescriptorSetLayout setLayouts[] =
+	{
+		usesDescriptors ? layout->DescriptorLayout : BindlessGetEmptyLayout(),
+		BindlessGetLayout(),
+	};
+	int setLayoutCount = usesDescriptors ? 1 : 0;
+	if (layout->UsesBindless) { setLayoutCount = BindlessSet + 1; }
 	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo =
 	{
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-		.setLayoutCount = pipeline->UsesDescriptors ? 1 : 0,
-		.pSetLayouts = &pipeline->DescriptorLayout,
-		.pushConstantRangeCount = pipeline->UsesPushConstant ? 1 : 0,
-		.pPushConstantRanges = &pushConstantRange,
+		.setLayoutCount = setLayoutCount,
+		.pSetLayouts = setLayouts,
+		.pushConstantRangeCount = layout->PushConstantRange.size > 0 ? 1 : 0,
+		.pPushConstantRanges = &layout->PushConstantRange,
+	};
+	vkCreatePipelineLayout(Graphics.Device, &pipelineLayoutCreateInfo, NULL, &layout->Instance);
+}
+
+static PipelineSharedLayout CreateSharedLayout(VkDescriptorSetLayoutBinding * bindings, int bindingCount, VkPushConstantRange pushConstantRange, bool usesBindless, unsigned long long hash)
+{
+	PipelineSharedLayout layout = malloc(sizeof(struct PipelineSharedLayout));
+	*layout = (struct PipelineSharedLayout)
+	{
+		.Hash = hash,
+		.ReferenceCount = 1,
+		.BindingCount = bindingCount,
+		.Bindings = bindings,
+		.PushConstantRange = pushConstantRange,
+		.UsesBindless = usesBindless,
+		.DescriptorLayout = VK_NULL_HANDLE,
 	};
-	vkCreatePipelineLayout(Graphics.Device, &pipelineLayoutCreateInfo, NULL, &pipeline->Layout);
+	if (bindingCount > 0)
+	{
+		VkDescriptorSetLayoutCreateInfo layoutInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = bindingCount,
+			.pBindings = bindings,
+		};
+		vkCreateDescriptorSetLayout(Graphics.Device, &layoutInfo, NULL, &layout->DescriptorLayout);
+	}
+	CreatePipelineLayout(layout);
+	return layout;
+}
+
+// Finds a layout with the same bindings and push constant range or creates one, the bindings are kept or freed
+static PipelineSharedLayout AcquireSharedLayout(VkDescriptorSetLayoutBinding * bindings, int bindingCount, VkPushConstantRange pushConstantRange, bool usesBindless)
+{
+	unsigned long long hash = HashLayout(bindings, bindingCount, pushConstantRange, usesBindless);
+	// Creating under the lock keeps two pipelines built at once from making the same layout twice
+	SDL_LockMutex(LayoutCache.Mutex);
+	for (int i = 0; i < ListGetCount(LayoutCache.Layouts); i++)
+	{
+		PipelineSharedLayout layout = ListGetValue(LayoutCache.Layouts, i);
+		if (layout->Hash == hash && SameLayout(layout, bindings, bindingCount, pushConstantRange, usesBindless))
+		{
+			layout->ReferenceCount++;
+			SDL_UnlockMutex(LayoutCache.Mutex);
+			free(bindings);
+			return layout;
+		}
+	}
+	PipelineSharedLayout layout = CreateSharedLayout(bindings, bindingCount, pushConstantRange, usesBindless, hash);
+	ListPush(LayoutCache.Layouts, layout);
+	SDL_UnlockMutex(LayoutCache.Mutex);
+	return layout;
+}
+
+static void ReleaseSharedLayout(PipelineSharedLayout layout)
+{
+	SDL_LockMutex(LayoutCache.Mutex);
+	bool destroy = --layout->ReferenceCount == 0;
+	if (destroy) { ListRemoveFirst(LayoutCache.Layouts, layout); }
+	SDL_UnlockMutex(LayoutCache.Mutex);
+	if (!destroy) { return; }
+	
+	vkDestroyPipelineLayout(Graphics.Device, layout->Instance, NULL);
+	if (layout->BindingCount > 0) { vkDestroyDescriptorSetLayout(Graphics.Device, layout->DescriptorLayout, NULL); }
+	free(layout->Bindings);
+	free(layout);
 }
 
 static void CreateLayout(Pipeline pipeline, PipelineConfigure config)
 {
 	CreateReflectModules(pipeline, config);
 	VkPushConstantRange pushConstantRange = GetPushConstantRange(pipeline);
-	int samplerCount = 0;
-	int uboCount = 0;
-	CreateDescriptorLayout(pipeline, &uboCount, &samplerCount);
-	CreateDescriptorPool(pipeline, uboCount, samplerCount);
-	CreatePipelineLayout(pipeline, pushConstantRange);
-	CreateDescriptorSets(pipeline);
+	int bindingCount;
+	VkDescriptorSetLayoutBinding * bindings = GetDescriptorBindings(pipeline, &bindingCount);
+	PipelineSharedLayout layout = AcquireSharedLayout(bindings, bindingCount, pushConstantRange, pipeline->UsesBindless);
+	
+	pipeline->SharedLayout = layout;
+	pipeline->Layout = layout->Instance;
+	pipeline->UsesDescriptors = layout->BindingCount > 0;
+	pipeline->DescriptorLayout = layout->DescriptorLayout;
+	// Only the layouts are shared, every pipeline keeps its own descriptor sets and uniforms
+	pipeline->DescriptorPool = VK_NULL_HANDLE;
+	pipeline->DescriptorSet = NULL;
+	pipeline->OverflowDescriptorSet = NULL;
+	pipeline->OverflowFrame = NULL;
+	if (pipeline->UsesDescriptors)
+	{
+		CreateDescriptorPool(pipeline, layout);
+		CreateDescriptorSets(pipeline, layout);
+	}
+	CreateDynamicUniforms(pipeline, layout);
+	if (pipeline->DynamicUniformCount > 0)
+	{
+		SDL_AtomicLock(&UniformRegistry.Lock);
+		if (UniformRegistry.Pipelines == NULL) { UniformRegistry.Pipelines = ListCreate(); }
+		ListPush(UniformRegistry.Pipelines, pipeline);
+		SDL_AtomicUnlock(&UniformRegistry.Lock);
+	}
 }
 
-Pipeline PipelineCreate(PipelineConfigure config)
+static SDL_atomic_t NextPipelineId = { 0 };
+
+static Pipeline AllocatePipeline(PipelineConfigure config)
 {
 	Pipeline pipeline = malloc(sizeof(struct Pipeline));
 	*pipeline = (struct Pipeline)
 	{
+		.Id = SDL_AtomicAdd(&NextPipelineId, 1),
 		.VertexLayout = config.VertexLayout,
 		.LineWidth = config.LineWidth,
 		.FrontStencilReference = config.FrontStencil.Reference,
 		.BackStencilReference = config.BackStencil.Reference,
+		.Job = NULL,
 	};
-	
+	return pipeline;
+}
+
+static void BuildPipeline(Pipeline pipeline, PipelineConfigure config)
+{
 	VkPipelineShaderStageCreateInfo shaderInfos[5];
 	VkShaderModule modules[5];
 	for (int i = 0; i < config.ShaderCount; i++)
@@ -282,8 +584,8 @@ Pipeline PipelineCreate(PipelineConfigure config)
 	VkPipelineVertexInputStateCreateInfo vertexInput =
 	{
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-		.vertexBindingDescriptionCount = 1,
-		.pVertexBindingDescriptions = &config.VertexLayout->Binding,
+		.vertexBindingDescriptionCount = config.VertexLayout->BindingCount,
+		.pVertexBindingDescriptions = config.VertexLayout->Bindings,
 		.vertexAttributeDescriptionCount = config.VertexLayout->AttributeCount,
 		.pVertexAttributeDescriptions = config.VertexLayout->Attributes,
 	};
@@ -423,90 +725,236 @@ Pipeline PipelineCreate(PipelineConfigure config)
 		.basePipelineHandle = VK_NULL_HANDLE,
 		.basePipelineIndex = -1,
 	};
-	VkResult result = vkCreateGraphicsPipelines(Graphics.Device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, NULL, &pipeline->Instance);
+	VkPipelineCreationFeedbackEXT creationFeedback = { 0 };
+	VkPipelineCreationFeedbackEXT stageFeedbacks[5];
+	VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT,
+		.pPipelineCreationFeedback = &creationFeedback,
+		.pipelineStageCreationFeedbackCount = config.ShaderCount,
+		.pPipelineStageCreationFeedbacks = stageFeedbacks,
+	};
+	if (Graphics.PipelineCreationFeedback) { pipelineCreateInfo.pNext = &feedbackInfo; }
+	
+	VkResult result = vkCreateGraphicsPipelines(Graphics.Device, Graphics.PipelineCache, 1, &pipelineCreateInfo, NULL, &pipeline->Instance);
 	if (result != VK_SUCCESS)
 	{
 		log_fatal("Unable to create graphics pipeline: %i\n", result);
 		exit(1);
 	}
 	
+	// Only the creation feedback extension can tell whether the driver used the cache, otherwise nothing is counted
+	if (Graphics.PipelineCreationFeedback)
+	{
+		bool cacheHit = creationFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT;
+		SDL_AtomicAdd(cacheHit ? &Graphics.Statistics.PipelineCacheHits : &Graphics.Statistics.PipelineCacheMisses, 1);
+	}
+	
 	for (int i = 0; i < config.ShaderCount; i++)
 	{
 		vkDestroyShaderModule(Graphics.Device, modules[i], NULL);
 	}
+}
+
+void PipelineInitialize()
+{
+	LayoutCache.Mutex = SDL_CreateMutex();
+	LayoutCache.Layouts = ListCreate();
+}
+
+Pipeline PipelineCreate(PipelineConfigure config)
+{
+	Pipeline pipeline = AllocatePipeline(config);
+	BuildPipeline(pipeline, config);
 	return pipeline;
 }
 
+struct PipelineBuild
+{
+	Pipeline Pipeline;
+	PipelineConfigure Config;
+};
+
+static void BuildPipelineJob(void * data)
+{
+	struct PipelineBuild * build = data;
+	BuildPipeline(build->Pipeline, build->Config);
+	free(build);
+}
+
+Pipeline PipelineCreateAsync(PipelineConfigure config)
+{
+	Pipeline pipeline = AllocatePipeline(config);
+	struct PipelineBuild * build = malloc(sizeof(struct PipelineBuild));
+	*build = (struct PipelineBuild){ .Pipeline = pipeline, .Config = config };
+	SDL_AtomicSetPtr((void **)&pipeline->Job, JobSubmit(BuildPipelineJob, build));
+	return pipeline;
+}
+
+void PipelineCreateBatch(int count, PipelineConfigure * configs, Pipeline * pipelines)
+{
+	for (int i = 0; i < count; i++) { pipelines[i] = PipelineCreateAsync(configs[i]); }
+	for (int i = 0; i < count; i++) { PipelineWait(pipelines[i]); }
+}
+
+bool PipelineIsReady(Pipeline pipeline)
+{
+	Job job = SDL_AtomicGetPtr((void **)&pipeline->Job);
+	return job == NULL || JobIsDone(job);
+}
+
+// Any thread can wait at the same time, so the job is kept until the pipeline is destroyed instead of being freed by whichever waits first
+void PipelineWait(Pipeline pipeline)
+{
+	Job job = SDL_AtomicGetPtr((void **)&pipeline->Job);
+	if (job != NULL) { JobWait(job); }
+}
+
 void PipelineSetPushConstant(Pipeline pipeline, const char * variable, void * value)
 {
-	if (pipeline->UsesPushConstant)
+	PipelineSetPushConstantHandle(pipeline, PipelineGetPushConstantHandle(pipeline, variable), value);
+}
+
+ShaderVariable PipelineGetPushConstantHandle(Pipeline pipeline, const char * variable)
+{
+	PipelineWait(pipeline);
+	if (!pipeline->UsesPushConstant) { return (ShaderVariable){ 0 }; }
+	return ShaderVariableTableFind(pipeline->PushConstantVariables, variable);
+}
+
+void PipelineSetPushConstantHandle(Pipeline pipeline, ShaderVariable variable, void * value)
+{
+	PipelineWait(pipeline);
+	if (variable.Size == 0) { return; }
+	memcpy((unsigned char *)pipeline->PushConstantData + variable.Offset, value, variable.Size);
+}
+
+// The descriptor always views the start of the frame's uniform ring, the draw supplies the offset
+static void QueueUniformWrite(Pipeline pipeline, int frameResource, struct PipelineDynamicUniform uniform)
+{
+	struct GraphicsDescriptorWrite write =
 	{
-		for (int i = 0; i < pipeline->PushConstantInfo.member_count; i++)
+		.Set = pipeline->DescriptorSet[frameResource],
+		.Binding = uniform.Binding,
+		.ArrayElement = uniform.ArrayElement,
+		.Type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		.Info.Buffer =
 		{
-			SpvReflectBlockVariable member = pipeline->PushConstantInfo.members[i];
-			if (strcmp(member.name, variable) == 0)
+			.buffer = Graphics.FrameResources[frameResource].UniformRing.Buffer,
+			.offset = 0,
+			.range = uniform.Uniform->Size,
+		},
+	};
+	GraphicsQueueDescriptorWrite(frameResource, write);
+}
+
+void PipelineSetUniform(Pipeline pipeline, int binding, int arrayIndex, struct UniformBuffer * uniform)
+{
+	PipelineWait(pipeline);
+	if (pipeline->UsesDescriptors)
+	{
+		for (int i = 0; i < pipeline->DynamicUniformCount; i++)
+		{
+			if (pipeline->DynamicUniforms[i].Binding == binding && pipeline->DynamicUniforms[i].ArrayElement == arrayIndex)
 			{
-				memcpy((unsigned char *)pipeline->PushConstantData + member.offset, value, member.size);
+				pipeline->DynamicUniforms[i].Uniform = uniform;
 			}
 		}
+		struct PipelineDynamicUniform write = { .Binding = binding, .ArrayElement = arrayIndex, .Uniform = uniform };
+		for (int i = 0; i < Graphics.FrameResourceCount; i++) { QueueUniformWrite(pipeline, i, write); }
 	}
 }
 
-void PipelineSetUniform(Pipeline pipeline, int binding, int arrayIndex, struct UniformBuffer * uniform)
+void PipelineRewriteUniforms(int frameResource)
 {
-	if (pipeline->UsesDescriptors)
+	SDL_AtomicLock(&UniformRegistry.Lock);
+	for (int i = 0; UniformRegistry.Pipelines != NULL && i < ListGetCount(UniformRegistry.Pipelines); i++)
 	{
-		for (int i = 0; i < Graphics.FrameResourceCount; i++)
+		Pipeline pipeline = ListGetValue(UniformRegistry.Pipelines, i);
+		for (int j = 0; j < pipeline->DynamicUniformCount; j++)
 		{
-			VkDescriptorBufferInfo * bufferInfo = malloc(sizeof(VkDescriptorBufferInfo));
-			*bufferInfo = (VkDescriptorBufferInfo)
-			{
-				.buffer = uniform->Buffer,
-				.offset = 0,
-				.range = uniform->Size,
-			};
-			
-			VkWriteDescriptorSet * writeInfo = malloc(sizeof(VkWriteDescriptorSet));
-			*writeInfo = (VkWriteDescriptorSet)
-			{
-				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-				.descriptorCount = 1,
-				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				.dstArrayElement = arrayIndex,
-				.dstBinding = binding,
-				.dstSet = pipeline->DescriptorSet[i],
-				.pBufferInfo = bufferInfo,
-			};
-			ListPush(Graphics.FrameResources[i].UpdateDescriptorQueue, writeInfo);
+			if (pipeline->DynamicUniforms[j].Uniform != NULL) { QueueUniformWrite(pipeline, frameResource, pipeline->DynamicUniforms[j]); }
 		}
 	}
+	SDL_AtomicUnlock(&UniformRegistry.Lock);
+}
+
+VkDescriptorSet PipelineGetOverflowSet(Pipeline pipeline, int frameResource, int frameNumber, VkBuffer buffer)
+{
+	VkDescriptorSet set = pipeline->OverflowDescriptorSet[frameResource];
+	if (pipeline->OverflowFrame[frameResource] == frameNumber) { return set; }
+	
+	// Writes are applied before copies in one update, so the descriptors are copied from the pipeline's set first then the uniforms are pointed at the overflow block
+	PipelineSharedLayout layout = pipeline->SharedLayout;
+	VkCopyDescriptorSet * copies = malloc(layout->BindingCount * sizeof(VkCopyDescriptorSet));
+	for (int i = 0; i < layout->BindingCount; i++)
+	{
+		copies[i] = (VkCopyDescriptorSet)
+		{
+			.sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET,
+			.srcSet = pipeline->DescriptorSet[frameResource],
+			.srcBinding = layout->Bindings[i].binding,
+			.dstSet = set,
+			.dstBinding = layout->Bindings[i].binding,
+			.descriptorCount = layout->Bindings[i].descriptorCount,
+		};
+	}
+	vkUpdateDescriptorSets(Graphics.Device, 0, NULL, layout->BindingCount, copies);
+	INSTRUMENT_VULKAN_CALLS(1);
+	free(copies);
+	
+	VkWriteDescriptorSet * writes = malloc(pipeline->DynamicUniformCount * sizeof(VkWriteDescriptorSet));
+	VkDescriptorBufferInfo * bufferInfos = malloc(pipeline->DynamicUniformCount * sizeof(VkDescriptorBufferInfo));
+	int writeCount = 0;
+	for (int i = 0; i < pipeline->DynamicUniformCount; i++)
+	{
+		struct PipelineDynamicUniform uniform = pipeline->DynamicUniforms[i];
+		if (uniform.Uniform == NULL) { continue; }
+		bufferInfos[writeCount] = (VkDescriptorBufferInfo){ .buffer = buffer, .offset = 0, .range = uniform.Uniform->Size };
+		writes[writeCount] = (VkWriteDescriptorSet)
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = set,
+			.dstBinding = uniform.Binding,
+			.dstArrayElement = uniform.ArrayElement,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+			.pBufferInfo = bufferInfos + writeCount,
+		};
+		writeCount++;
+	}
+	if (writeCount > 0)
+	{
+		vkUpdateDescriptorSets(Graphics.Device, writeCount, writes, 0, NULL);
+		INSTRUMENT_VULKAN_CALLS(1);
+	}
+	free(bufferInfos);
+	free(writes);
+	pipeline->OverflowFrame[frameResource] = frameNumber;
+	return set;
 }
 
 void PipelineSetSampler(Pipeline pipeline, int binding, int arrayIndex, Texture texture)
 {
+	PipelineWait(pipeline);
 	if (pipeline->UsesDescriptors)
 	{
 		for (int i = 0; i < Graphics.FrameResourceCount; i++)
 		{
-			VkDescriptorImageInfo * imageInfo = malloc(sizeof(VkDescriptorImageInfo));
-			*imageInfo = (VkDescriptorImageInfo)
-			{
-				.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
-				.sampler = texture->Sampler,
-				.imageView = texture->ImageView,
-			};
-			VkWriteDescriptorSet * writeInfo = malloc(sizeof(VkWriteDescriptorSet));
-			*writeInfo = (VkWriteDescriptorSet)
+			struct GraphicsDescriptorWrite write =
 			{
-				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-				.descriptorCount = 1,
-				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				.dstArrayElement = arrayIndex,
-				.dstBinding = binding,
-				.dstSet = pipeline->DescriptorSet[i],
-				.pImageInfo = imageInfo,
+				.Set = pipeline->DescriptorSet[i],
+				.Binding = binding,
+				.ArrayElement = arrayIndex,
+				.Type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.Info.Image =
+				{
+					.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+					.sampler = texture->Sampler,
+					.imageView = texture->ImageView,
+				},
 			};
-			ListPush(Graphics.FrameResources[i].UpdateDescriptorQueue, writeInfo);
+			GraphicsQueueDescriptorWrite(i, write);
 		}
 	}
 }
@@ -527,23 +975,53 @@ void PipelineSetBackStencilReference(Pipeline pipeline, unsigned int reference)
 
 void PipelineQueueDestroy(Pipeline pipeline)
 {
-	ListPush(Graphics.FrameResources[Graphics.FrameIndex].DestroyPipelineQueue, pipeline);
+	GraphicsQueueDestroy(GraphicsDestroyTypePipeline, pipeline);
 }
 
 void PipelineDestroy(Pipeline pipeline)
 {
 	vkDeviceWaitIdle(Graphics.Device);
-	vkDestroyPipelineLayout(Graphics.Device, pipeline->Layout, NULL);
+	PipelineDestroyQueued(pipeline);
+}
+
+void PipelineDestroyQueued(Pipeline pipeline)
+{
+	Job job = SDL_AtomicSetPtr((void **)&pipeline->Job, NULL);
+	if (job != NULL) { JobDestroy(job); }
 	if (pipeline->UsesDescriptors)
 	{
 		free(pipeline->DescriptorSet);
-		vkDestroyDescriptorSetLayout(Graphics.Device, pipeline->DescriptorLayout, NULL);
+		free(pipeline->OverflowDescriptorSet);
+		free(pipeline->OverflowFrame);
 		vkDestroyDescriptorPool(Graphics.Device, pipeline->DescriptorPool, NULL);
 	}
-	if (pipeline->UsesPushConstant) { free(pipeline->PushConstantData); }
+	if (pipeline->DynamicUniformCount > 0)
+	{
+		SDL_AtomicLock(&UniformRegistry.Lock);
+		ListRemoveFirst(UniformRegistry.Pipelines, pipeline);
+		if (ListGetCount(UniformRegistry.Pipelines) == 0)
+		{
+			ListDestroy(UniformRegistry.Pipelines);
+			UniformRegistry.Pipelines = NULL;
+		}
+		SDL_AtomicUnlock(&UniformRegistry.Lock);
+	}
+	free(pipeline->DynamicUniforms);
+	ReleaseSharedLayout(pipeline->SharedLayout);
+	if (pipeline->UsesPushConstant)
+	{
+		free(pipeline->PushConstantData);
+		ShaderVariableTableDestroy(pipeline->PushConstantVariables);
+	}
 	spvReflectDestroyShaderModule(&pipeline->Stages[0].Module);
 	spvReflectDestroyShaderModule(&pipeline->Stages[1].Module);
 	free(pipeline->Stages);
 	vkDestroyPipeline(Graphics.Device, pipeline->Instance, NULL);
 	free(pipeline);
 }
+
+void PipelineDeinitialize()
+{
+	ListDestroy(LayoutCache.Layouts);
+	SDL_DestroyMutex(LayoutCache.Mutex);
+}
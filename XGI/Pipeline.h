@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <spirv/spirv_reflect.h>
 #include "VertexBuffer.h"
+#include "ShaderVariable.h"
 #include "UniformBuffer.h"
 #include "Texture.h"
 
@@ -94,15 +95,27 @@ typedef struct StencilConfigure
 	unsigned int Reference;
 } StencilConfigure;
 
+typedef enum ShaderDataStorage
+{
+	/// The data belongs to the user and isn't freed by ShaderDataDestroy
+	ShaderDataStorageUser,
+	/// The data was allocated on the heap
+	ShaderDataStorageHeap,
+	/// The data is a mapped shader cache file
+	ShaderDataStorageMapped,
+} ShaderDataStorage;
+
 typedef struct ShaderData
 {
 	ShaderType Type;
 	unsigned long DataSize;
 	void * Data;
+	ShaderDataStorage Storage;
 } ShaderData;
 
 /// Loads a shader from memory.
-/// GLSL strings are accepted just set precompiled to false
+/// GLSL strings are accepted just set precompiled to false.
+/// Compiled GLSL is stored in the shader cache if GraphicsConfigure.ShaderCachePath is set
 /// \param type The type of shader
 /// \param dataSize The size of the data to load
 /// \param data The data to load
@@ -117,6 +130,20 @@ ShaderData ShaderDataFromMemory(ShaderType type, unsigned long dataSize, void *
 /// \return The shader data required for the pipeline configuration
 ShaderData ShaderDataFromFile(ShaderType type, const char * file, bool precompiled);
 
+/// Loads many shaders from files at once.
+/// GLSL files are compiled in parallel on the worker threads, this blocks until all of them are loaded
+/// \param types The type of each shader
+/// \param files The path of each shader
+/// \param count The number of shaders
+/// \param precompiled Whether or not the files are already compiled to SPIR-V
+/// \param data The array that count shader datas are written to
+void ShaderDataFromFiles(const ShaderType * types, const char ** files, int count, bool precompiled, ShaderData * data);
+
+/// Frees the memory held by a shader data.
+/// This can be called as soon as the pipelines using it have been created
+/// \param data The shader data to destroy
+void ShaderDataDestroy(ShaderData data);
+
 typedef struct PipelineConfigure
 {
 	/// The vertex layout that the pipeline uses.
@@ -153,9 +180,36 @@ typedef struct PipelineConfigure
 	StencilConfigure BackStencil;
 } PipelineConfigure;
 
+/// A uniform buffer bound to a binding of a pipeline layout
+struct PipelineDynamicUniform
+{
+	unsigned int Binding;
+	unsigned int ArrayElement;
+	struct UniformBuffer * Uniform;
+};
+
+/// Descriptor and pipeline layouts shared by every pipeline whose shaders reflect the same bindings and push constant range.
+/// Only the layouts are shared, each pipeline still allocates its own descriptor sets from the shared descriptor set layout
+/// so that its samplers and uniforms can be set separately. Switching between pipelines with the same layout keeps the push constants
+/// that were pushed, but binds the other pipeline's descriptor set
+typedef struct PipelineSharedLayout
+{
+	unsigned long long Hash;
+	int ReferenceCount;
+	/// The set 0 bindings of every stage merged and sorted by binding number
+	int BindingCount;
+	VkDescriptorSetLayoutBinding * Bindings;
+	VkPushConstantRange PushConstantRange;
+	bool UsesBindless;
+	VkPipelineLayout Instance;
+	VkDescriptorSetLayout DescriptorLayout;
+} * PipelineSharedLayout;
+
 typedef struct Pipeline
 {
 	VkPipeline Instance;
+	/// A number unique to the pipeline, used to group draws by pipeline when sorting
+	unsigned int Id;
 	VkPipelineLayout Layout;
 	VertexLayout VertexLayout;
 	Scalar LineWidth;
@@ -170,39 +224,106 @@ typedef struct Pipeline
 		int BindingCount;
 		SpvReflectDescriptorSet DescriptorInfo;
 	} * Stages;
+	/// The pipeline and descriptor set layouts below belong to it
+	PipelineSharedLayout SharedLayout;
 	bool UsesDescriptors;
+	/// Whether or not a shader declares the bindless texture table
+	bool UsesBindless;
 	VkDescriptorSetLayout DescriptorLayout;
 	VkDescriptorPool DescriptorPool;
 	VkDescriptorSet * DescriptorSet;
+	/// A second set for each frame resource that views the uniform ring's overflow block, used by the draws made after the ring filled up
+	VkDescriptorSet * OverflowDescriptorSet;
+	/// The number of the frame each overflow set was last written for
+	int * OverflowFrame;
+	/// The uniform buffers bound to the pipeline, sorted in the order of their dynamic offsets
+	int DynamicUniformCount;
+	struct PipelineDynamicUniform * DynamicUniforms;
 	bool UsesPushConstant;
 	SpvReflectBlockVariable PushConstantInfo;
+	ShaderVariableTable PushConstantVariables;
 	void * PushConstantData;
 	unsigned int PushConstantSize;
+	/// The job building a pipeline from PipelineCreateAsync, it's swapped out atomically and freed when the pipeline is destroyed
+	struct Job * Job;
 } * Pipeline;
 
+/// This should not be called by the user, it is called in the GraphicsInitialize function
+void PipelineInitialize(void);
+
 /// Creates a pipeline from a pipeline configuration
 /// \param config The pipeline configuration to use
 /// \return The pipeline object
 Pipeline PipelineCreate(PipelineConfigure config);
 
+/// Starts creating a pipeline on a worker thread and returns right away.
+/// The shader datas in the configuration must stay valid until the pipeline is ready.
+/// GLSL is compiled when the shader datas are loaded, use ShaderDataFromFiles to compile them in parallel as well.
+/// Using the pipeline in any other function waits for it to be ready
+/// \param config The pipeline configuration to use
+/// \return The pipeline object
+Pipeline PipelineCreateAsync(PipelineConfigure config);
+
+/// Creates many pipelines in parallel on the worker threads and waits for all of them
+/// \param count The number of pipelines to create
+/// \param configs An array of count pipeline configurations
+/// \param pipelines An array of count pipelines that is filled with the created pipelines
+void PipelineCreateBatch(int count, PipelineConfigure * configs, Pipeline * pipelines);
+
+/// Checks if a pipeline created with PipelineCreateAsync is ready without blocking
+/// \param pipeline The pipeline to check
+/// \return Whether or not the pipeline is ready to use
+bool PipelineIsReady(Pipeline pipeline);
+
+/// Blocks until a pipeline created with PipelineCreateAsync is ready, this can be called from any thread
+/// \param pipeline The pipeline to wait for
+void PipelineWait(Pipeline pipeline);
+
 /// Sets a push constant value in the pipeline shaders
 /// \param pipeline The pipeline to set push constants
 /// \param variableName The name of the member in the push_constant struct
 /// \param value A pointer to the memory to set, it's assumed that the pointer points to data that is the correct size
 void PipelineSetPushConstant(Pipeline pipeline, const char * variableName, void * value);
 
+/// Looks up a member of the push_constant struct so it can be set without searching by name every time
+/// \param pipeline The pipeline to look in
+/// \param variableName The name of the member in the push_constant struct
+/// \return The handle to the member, it stays valid for the lifetime of the pipeline
+ShaderVariable PipelineGetPushConstantHandle(Pipeline pipeline, const char * variableName);
+
+/// Sets a push constant value using a handle from PipelineGetPushConstantHandle
+/// \param pipeline The pipeline to set push constants
+/// \param variable The handle to the member
+/// \param value A pointer to the memory to set, it's assumed that the pointer points to data that is the correct size
+void PipelineSetPushConstantHandle(Pipeline pipeline, ShaderVariable variable, void * value);
+
 /// Sets a uniform buffer to a binding in the shader.
-/// This is not like push constanst where the buffer can be changed in between draw calls,
-/// If the buffer needs to be changed then make the binding an array of values and use push constants to change which index to use.
+/// The values in the uniform buffer can be changed in between draw calls, each draw uses the values set before it.
 /// \param pipeline The pipeline to set
 /// \param binding The binding specified in the shader to set
 /// \param arrayIndex The index in the array to set (0 if it's not an array)
 /// \param uniform The uniform buffer object containing the data to set
 void PipelineSetUniform(Pipeline pipeline, int binding, int arrayIndex, struct UniformBuffer * uniform);
 
-/// Sets a sampler2D to a binding in the shader
+/// Queues the uniform buffer descriptors of every pipeline to be written again for a frame resource whose uniform ring was replaced.
+/// This should not be called by the user, it is called in the GraphicsAquireNextImage function
+/// \param frameResource The index of the frame resource
+void PipelineRewriteUniforms(int frameResource);
+
+/// Gets the descriptor set that views the uniform ring's overflow block instead of the ring, writing it the first time the frame uses it.
+/// It holds the same descriptors as the pipeline's set for the frame resource apart from the uniform buffers.
+/// This should not be called by the user, it is called when drawing with the lock of the frame's uniform ring held
+/// \param pipeline The pipeline being drawn with
+/// \param frameResource The index of the frame resource being recorded
+/// \param frameNumber The number of the frame being recorded
+/// \param buffer The overflow block of the frame's uniform ring
+/// \return The descriptor set to bind in place of the pipeline's set
+VkDescriptorSet PipelineGetOverflowSet(Pipeline pipeline, int frameResource, int frameNumber, VkBuffer buffer);
+
+/// Sets a sampler2D to a binding in the shader.
 /// This is not like push constants where the sampler can be chagned in between draw calls.
-/// If the sampler needs to be changed then make the binding an array of samplers and use push constants to change which array index.
+/// If the sampler needs to be changed then use the bindless texture table (see Bindless.h) with the texture's Index in a push constant,
+/// or an array texture with the layer in a push constant if the device doesn't support descriptor indexing.
 /// \param pipeline The pipeline to modify
 /// \param binding The binding specified in the shader to set
 /// \param arrayIndex The index in the array to set (0 if it's not an array)
@@ -234,4 +355,12 @@ void PipelineQueueDestroy(Pipeline pipeline);
 /// \param pipeline The pipeline to destroy
 void PipelineDestroy(Pipeline pipeline);
 
+/// This should not be called by the user, it destroys the pipelines queued with PipelineQueueDestroy.
+/// Unlike PipelineDestroy it doesn't wait for the device to be idle, the frames that used the pipeline have already finished
+/// \param pipeline The pipeline to destroy
+void PipelineDestroyQueued(Pipeline pipeline);
+
+/// This should not be called by the user, it is called in the GraphicsDeinitialize function
+void PipelineDeinitialize(void);
+
 #endif
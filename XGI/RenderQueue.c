@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <string.h>
+#include "RenderQueue.h"
+#include "Graphics.h"
+
+RenderQueue RenderQueueCreate(int capacity)
+{
+	RenderQueue queue = malloc(sizeof(struct RenderQueue));
+	capacity = MAX(capacity, 1);
+	*queue = (struct RenderQueue)
+	{
+		.Count = 0,
+		.Capacity = capacity,
+		.Draws = malloc(capacity * sizeof(struct RenderQueueDraw)),
+		.Keys = malloc(capacity * sizeof(uint64_t)),
+		.Order = malloc(capacity * sizeof(unsigned int)),
+		.ScratchKeys = malloc(capacity * sizeof(uint64_t)),
+		.ScratchOrder = malloc(capacity * sizeof(unsigned int)),
+		.PushConstantData = NULL,
+		.PushConstantSize = 0,
+		.PushConstantCapacity = 0,
+	};
+	return queue;
+}
+
+// From the most significant bits: pass (7), transparent (1), then pipeline (16), material (16), depth (24) for opaque draws,
+// or inverted depth (24), pipeline (16), material (16) for transparent draws
+static uint64_t GetSortKey(RenderPacket packet)
+{
+	// The bits of a non-negative float sort the same as its value, the top 24 below the sign are kept
+	Scalar depth = MAX(packet.Depth, 0.0f);
+	uint32_t depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+	uint64_t depthKey = depthBits >> 7;
+	uint64_t pipeline = packet.Pipeline->Id & 0xFFFF;
+	uint64_t material = packet.Material & 0xFFFF;
+	uint64_t key = (uint64_t)(packet.Pass & 0x7F) << 57;
+	if (packet.Transparent) { return key | 1ULL << 56 | (~depthKey & 0xFFFFFF) << 32 | pipeline << 16 | material; }
+	return key | pipeline << 40 | material << 24 | depthKey;
+}
+
+void RenderQueueSubmit(RenderQueue queue, RenderPacket packet)
+{
+	if (queue->Count == queue->Capacity)
+	{
+		queue->Capacity *= 2;
+		queue->Draws = realloc(queue->Draws, queue->Capacity * sizeof(struct RenderQueueDraw));
+		queue->Keys = realloc(queue->Keys, queue->Capacity * sizeof(uint64_t));
+		queue->Order = realloc(queue->Order, queue->Capacity * sizeof(unsigned int));
+		queue->ScratchKeys = realloc(queue->ScratchKeys, queue->Capacity * sizeof(uint64_t));
+		queue->ScratchOrder = realloc(queue->ScratchOrder, queue->Capacity * sizeof(unsigned int));
+	}
+
+	long pushConstantOffset = -1;
+	if (packet.PushConstants != NULL)
+	{
+		// The push constant size isn't known until the pipeline is built
+		PipelineWait(packet.Pipeline);
+		size_t size = packet.Pipeline->PushConstantSize;
+		if (queue->PushConstantSize + size > queue->PushConstantCapacity)
+		{
+			queue->PushConstantCapacity = MAX(queue->PushConstantCapacity * 2, queue->PushConstantSize + size);
+			queue->PushConstantData = realloc(queue->PushConstantData, queue->PushConstantCapacity);
+		}
+		memcpy(queue->PushConstantData + queue->PushConstantSize, packet.PushConstants, size);
+		pushConstantOffset = queue->PushConstantSize;
+		queue->PushConstantSize += size;
+	}
+
+	int count = packet.Count;
+	if (count == 0) { count = packet.IndexBuffer != NULL ? packet.IndexBuffer->IndexCount : packet.VertexBuffer->VertexCount; }
+	queue->Draws[queue->Count] = (struct RenderQueueDraw)
+	{
+		.Pipeline = packet.Pipeline,
+		.VertexBuffer = packet.VertexBuffer,
+		.IndexBuffer = packet.IndexBuffer,
+		.First = packet.First,
+		.Count = count,
+		.PushConstantOffset = pushConstantOffset,
+	};
+	queue->Keys[queue->Count] = GetSortKey(packet);
+	queue->Count++;
+}
+
+// Least significant byte first, the histograms of every byte are counted in one pass over the keys.
+// Bytes that are the same in every key are skipped since sorting by them wouldn't move anything.
+// Returns the draw indices in sorted order
+static unsigned int * RadixSort(RenderQueue queue)
+{
+	uint64_t * keys = queue->Keys, * scratchKeys = queue->ScratchKeys;
+	unsigned int * order = queue->Order, * scratchOrder = queue->ScratchOrder;
+	unsigned int counts[8][256] = { 0 };
+	for (int i = 0; i < queue->Count; i++)
+	{
+		order[i] = i;
+		for (int b = 0; b < 8; b++) { counts[b][(keys[i] >> (b * 8)) & 0xFF]++; }
+	}
+
+	for (int b = 0; b < 8; b++)
+	{
+		int shift = b * 8;
+		if (counts[b][(keys[0] >> shift) & 0xFF] == (unsigned int)queue->Count) { continue; }
+		unsigned int offset = 0;
+		for (int d = 0; d < 256; d++)
+		{
+			unsigned int count = counts[b][d];
+			counts[b][d] = offset;
+			offset += count;
+		}
+		for (int i = 0; i < queue->Count; i++)
+		{
+			unsigned int destination = counts[b][(keys[i] >> shift) & 0xFF]++;
+			scratchKeys[destination] = keys[i];
+			scratchOrder[destination] = order[i];
+		}
+		uint64_t * swapKeys = keys;
+		keys = scratchKeys;
+		scratchKeys = swapKeys;
+		unsigned int * swapOrder = order;
+		order = scratchOrder;
+		scratchOrder = swapOrder;
+	}
+	return order;
+}
+
+void RenderQueueFlush(RenderQueue queue)
+{
+	if (queue->Count == 0) { return; }
+	unsigned int * order = RadixSort(queue);
+	Pipeline bound = NULL;
+	for (int i = 0; i < queue->Count; i++)
+	{
+		struct RenderQueueDraw * draw = queue->Draws + order[i];
+		if (draw->PushConstantOffset >= 0)
+		{
+			// Binding again only pushes the constants if they changed
+			memcpy(draw->Pipeline->PushConstantData, queue->PushConstantData + draw->PushConstantOffset, draw->Pipeline->PushConstantSize);
+			bound = NULL;
+		}
+		if (draw->Pipeline != bound)
+		{
+			GraphicsBindPipeline(draw->Pipeline);
+			bound = draw->Pipeline;
+		}
+		if (draw->IndexBuffer != NULL) { GraphicsRenderIndexed(draw->VertexBuffer, draw->IndexBuffer, draw->First, draw->Count); }
+		else { GraphicsRenderVertexRange(draw->VertexBuffer, draw->First, draw->Count); }
+	}
+	RenderQueueClear(queue);
+}
+
+void RenderQueueClear(RenderQueue queue)
+{
+	queue->Count = 0;
+	queue->PushConstantSize = 0;
+}
+
+void RenderQueueDestroy(RenderQueue queue)
+{
+	free(queue->Draws);
+	free(queue->Keys);
+	free(queue->Order);
+	free(queue->ScratchKeys);
+	free(queue->ScratchOrder);
+	free(queue->PushConstantData);
+	free(queue);
+}
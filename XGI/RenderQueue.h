@@ -0,0 +1,88 @@
+#ifndef RenderQueue_h
+#define RenderQueue_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "LinearMath.h"
+#include "Pipeline.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+
+/// One draw for a render queue to sort and record
+typedef struct RenderPacket
+{
+	/// The pass the draw belongs to, the draws of lower passes are recorded first (0 to 127)
+	unsigned int Pass;
+	/// Whether or not the draw is blended.
+	/// Blended draws are recorded after the opaque draws of their pass and sorted back to front instead of by state
+	bool Transparent;
+	/// The pipeline to draw with
+	Pipeline Pipeline;
+	/// Identifies the textures and other resources the draw uses, draws with the same pipeline and material are recorded together (0 to 65535)
+	unsigned int Material;
+	/// The distance from the camera, any non-negative value.
+	/// Opaque draws with the same pipeline and material are recorded front to back so that hidden fragments fail the depth test early
+	Scalar Depth;
+	/// The vertices to draw
+	VertexBuffer VertexBuffer;
+	/// The indices to draw with, NULL to draw the vertices in order
+	IndexBuffer IndexBuffer;
+	/// The first vertex to draw, or the first index if there's an index buffer
+	int First;
+	/// The number of vertices or indices to draw, 0 draws the whole buffer
+	int Count;
+	/// The push constant block of the draw, it must be the size of the pipeline's push constants.
+	/// This is how per-draw data such as a transform or a bindless texture index is given. NULL keeps the pipeline's push constants
+	const void * PushConstants;
+} RenderPacket;
+
+typedef struct RenderQueue
+{
+	int Count;
+	int Capacity;
+	struct RenderQueueDraw
+	{
+		Pipeline Pipeline;
+		VertexBuffer VertexBuffer;
+		IndexBuffer IndexBuffer;
+		int First;
+		int Count;
+		/// The offset of the draw's push constants in PushConstantData, -1 if it doesn't have any
+		long PushConstantOffset;
+	} * Draws;
+	uint64_t * Keys;
+	unsigned int * Order;
+	/// The radix sort ping-pongs between these and the arrays above
+	uint64_t * ScratchKeys;
+	unsigned int * ScratchOrder;
+	unsigned char * PushConstantData;
+	size_t PushConstantSize;
+	size_t PushConstantCapacity;
+} * RenderQueue;
+
+/// Creates a queue that collects draws so that they can be recorded in an order with fewer state changes
+/// \param capacity The number of draws to allocate room for, the queue grows if more are submitted
+/// \return The render queue object
+RenderQueue RenderQueueCreate(int capacity);
+
+/// Adds a draw to the queue, nothing is recorded until RenderQueueFlush.
+/// The push constants are copied, but uniform buffers are read when the queue is flushed like any other draw
+/// \param queue The queue to add to
+/// \param packet The draw to add
+void RenderQueueSubmit(RenderQueue queue, RenderPacket packet);
+
+/// Sorts the submitted draws by pass, pipeline, material and depth then records them and empties the queue.
+/// The pipelines are bound as they're needed, the push constants of a pipeline are left as the last draw that used it set them.
+/// This should only be called after GraphicsBegin and before GraphicsEnd
+/// \param queue The queue to record
+void RenderQueueFlush(RenderQueue queue);
+
+/// Empties the queue without recording anything
+/// \param queue The queue to empty
+void RenderQueueClear(RenderQueue queue);
+
+/// Destroys and frees a render queue object
+/// \param queue The queue to destroy
+void RenderQueueDestroy(RenderQueue queue);
+
+#endif
@@ -0,0 +1,40 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ShaderVariable.h"
+
+static int CompareShaderVariables(const void * a, const void * b)
+{
+	return strcmp(((const struct ShaderVariableEntry *)a)->Name, ((const struct ShaderVariableEntry *)b)->Name);
+}
+
+ShaderVariableTable ShaderVariableTableCreate(SpvReflectBlockVariable block)
+{
+	ShaderVariableTable table =
+	{
+		.Count = block.member_count,
+		.Entries = malloc((block.member_count > 0 ? block.member_count : 1) * sizeof(struct ShaderVariableEntry)),
+	};
+	for (int i = 0; i < table.Count; i++)
+	{
+		// The names are copied so the table doesn't depend on the lifetime of the reflection data
+		const char * name = block.members[i].name != NULL ? block.members[i].name : "";
+		table.Entries[i].Name = malloc(strlen(name) + 1);
+		strcpy(table.Entries[i].Name, name);
+		table.Entries[i].Variable = (ShaderVariable){ .Offset = block.members[i].offset, .Size = block.members[i].size };
+	}
+	qsort(table.Entries, table.Count, sizeof(struct ShaderVariableEntry), CompareShaderVariables);
+	return table;
+}
+
+ShaderVariable ShaderVariableTableFind(ShaderVariableTable table, const char * name)
+{
+	struct ShaderVariableEntry key = { .Name = (char *)name };
+	struct ShaderVariableEntry * entry = bsearch(&key, table.Entries, table.Count, sizeof(struct ShaderVariableEntry), CompareShaderVariables);
+	return entry != NULL ? entry->Variable : (ShaderVariable){ 0 };
+}
+
+void ShaderVariableTableDestroy(ShaderVariableTable table)
+{
+	for (int i = 0; i < table.Count; i++) { free(table.Entries[i].Name); }
+	free(table.Entries);
+}
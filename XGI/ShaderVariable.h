@@ -0,0 +1,41 @@
+#ifndef ShaderVariable_h
+#define ShaderVariable_h
+
+#include <spirv/spirv_reflect.h>
+
+/// A handle to a member of a uniform buffer or push constant block, looked up once by name
+typedef struct ShaderVariable
+{
+	unsigned int Offset;
+	/// The size of the member in bytes, 0 if the member wasn't found
+	unsigned int Size;
+} ShaderVariable;
+
+/// The members of a uniform or push constant block sorted by name
+typedef struct ShaderVariableTable
+{
+	int Count;
+	struct ShaderVariableEntry
+	{
+		char * Name;
+		ShaderVariable Variable;
+	} * Entries;
+} ShaderVariableTable;
+
+/// Builds the sorted member table of a reflected block.
+/// The user shouldn't need to call this
+/// \param block The reflected block
+/// \return The table, it must be destroyed with ShaderVariableTableDestroy
+ShaderVariableTable ShaderVariableTableCreate(SpvReflectBlockVariable block);
+
+/// Finds a member in a table with a binary search
+/// \param table The table to search
+/// \param name The name of the member
+/// \return The member's handle, its size is 0 if it wasn't found
+ShaderVariable ShaderVariableTableFind(ShaderVariableTable table, const char * name);
+
+/// Frees the memory of a table
+/// \param table The table to destroy
+void ShaderVariableTableDestroy(ShaderVariableTable table);
+
+#endif
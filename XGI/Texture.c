@@ -1,12 +1,173 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <vk_mem_alloc.h>
 #include <stb_image.h>
 #include "Texture.h"
 #include "Graphics.h"
+#include "Transfer.h"
+#include "Bindless.h"
 #include "File.h"
+#include "Job.h"
 #include "log.h"
 
+static const unsigned char KTX2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// Both containers are little endian
+static uint32_t ReadUInt32(const unsigned char * data)
+{
+	return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static uint64_t ReadUInt64(const unsigned char * data)
+{
+	return ReadUInt32(data) | (uint64_t)ReadUInt32(data + 4) << 32;
+}
+
+static bool IsCompressed(TextureFormat format)
+{
+	return format >= (TextureFormat)VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= (TextureFormat)VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+// Larger images aren't supported by any device, the limit keeps the level size math from overflowing
+#define MaxFileTextureDimension 65536
+
+// Header values are checked before they're used in any size math, a malformed file could otherwise make the loaders read out of bounds
+static void CheckDimensions(const char * fileName, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+	uint32_t maxMipLevels = 1;
+	while ((MAX(width, height) >> maxMipLevels) > 0) { maxMipLevels++; }
+	if (width == 0 || height == 0 || width > MaxFileTextureDimension || height > MaxFileTextureDimension || mipLevels > maxMipLevels)
+	{
+		log_fatal("%s has an invalid size of %ux%u with %u mip levels\n", fileName, width, height, mipLevels);
+		exit(1);
+	}
+}
+
+static TextureData LoadKTX2(const char * fileName, const unsigned char * data, unsigned long size)
+{
+	if (size < 80)
+	{
+		log_fatal("%s is too small to be a KTX2 file\n", fileName);
+		exit(1);
+	}
+	TextureData textureData =
+	{
+		.Format = (TextureFormat)ReadUInt32(data + 12),
+		.Width = ReadUInt32(data + 20),
+		.Height = ReadUInt32(data + 24),
+		.MipLevels = MAX(ReadUInt32(data + 40), 1),
+	};
+	CheckDimensions(fileName, textureData.Width, textureData.Height, textureData.MipLevels);
+	unsigned int layerCount = ReadUInt32(data + 32), faceCount = ReadUInt32(data + 36), supercompression = ReadUInt32(data + 44);
+	if (!IsCompressed(textureData.Format) || supercompression != 0 || layerCount > 1 || faceCount > 1)
+	{
+		log_fatal("%s must be a single 2D image in a BC format without supercompression\n", fileName);
+		exit(1);
+	}
+	if (80 + (uint64_t)textureData.MipLevels * 24 > size)
+	{
+		log_fatal("%s has a truncated level index\n", fileName);
+		exit(1);
+	}
+	
+	// The level index goes from the largest level to the smallest, but the data can be stored in any order.
+	// The size comes from the checked dimensions, each level's stored size has to match it
+	for (unsigned int i = 0; i < textureData.MipLevels; i++)
+	{
+		textureData.Size += TransferGetLevelSize((VkFormat)textureData.Format, MAX(textureData.Width >> i, 1), MAX(textureData.Height >> i, 1));
+	}
+	textureData.Pixels = malloc(textureData.Size);
+	size_t offset = 0;
+	for (unsigned int i = 0; i < textureData.MipLevels; i++)
+	{
+		uint64_t levelOffset = ReadUInt64(data + 80 + i * 24), levelSize = ReadUInt64(data + 80 + i * 24 + 8);
+		size_t expectedSize = TransferGetLevelSize((VkFormat)textureData.Format, MAX(textureData.Width >> i, 1), MAX(textureData.Height >> i, 1));
+		if (levelOffset > size || levelSize > size - levelOffset || levelSize != expectedSize)
+		{
+			log_fatal("%s has an invalid mip level %i\n", fileName, i);
+			exit(1);
+		}
+		memcpy((unsigned char *)textureData.Pixels + offset, data + levelOffset, levelSize);
+		offset += levelSize;
+	}
+	return textureData;
+}
+
+static TextureFormat GetDXGIFormat(uint32_t dxgiFormat)
+{
+	switch (dxgiFormat)
+	{
+		case 71: return TextureFormatBC1;
+		case 72: return TextureFormatBC1SRGB;
+		case 74: return TextureFormatBC2;
+		case 75: return TextureFormatBC2SRGB;
+		case 77: return TextureFormatBC3;
+		case 78: return TextureFormatBC3SRGB;
+		case 80: return TextureFormatBC4;
+		case 83: return TextureFormatBC5;
+		case 95: return TextureFormatBC6H;
+		case 98: return TextureFormatBC7;
+		case 99: return TextureFormatBC7SRGB;
+		default: return TextureFormatColor;
+	}
+}
+
+static TextureData LoadDDS(const char * fileName, const unsigned char * data, unsigned long size)
+{
+	if (size < 128)
+	{
+		log_fatal("%s is too small to be a DDS file\n", fileName);
+		exit(1);
+	}
+	TextureData textureData =
+	{
+		.Format = TextureFormatColor,
+		.Height = ReadUInt32(data + 12),
+		.Width = ReadUInt32(data + 16),
+		// The mip count is only valid with DDSD_MIPMAPCOUNT
+		.MipLevels = ReadUInt32(data + 8) & 0x20000 ? MAX(ReadUInt32(data + 28), 1) : 1,
+	};
+	CheckDimensions(fileName, textureData.Width, textureData.Height, textureData.MipLevels);
+	const unsigned char * fourCC = data + 84;
+	unsigned long dataOffset = 128;
+	if (memcmp(fourCC, "DXT1", 4) == 0) { textureData.Format = TextureFormatBC1; }
+	else if (memcmp(fourCC, "DXT3", 4) == 0) { textureData.Format = TextureFormatBC2; }
+	else if (memcmp(fourCC, "DXT5", 4) == 0) { textureData.Format = TextureFormatBC3; }
+	else if (memcmp(fourCC, "ATI1", 4) == 0 || memcmp(fourCC, "BC4U", 4) == 0) { textureData.Format = TextureFormatBC4; }
+	else if (memcmp(fourCC, "ATI2", 4) == 0 || memcmp(fourCC, "BC5U", 4) == 0) { textureData.Format = TextureFormatBC5; }
+	else if (memcmp(fourCC, "DX10", 4) == 0 && size >= 148)
+	{
+		textureData.Format = GetDXGIFormat(ReadUInt32(data + 128));
+		if (ReadUInt32(data + 140) > 1)
+		{
+			log_fatal("%s is a texture array, which isn't supported\n", fileName);
+			exit(1);
+		}
+		dataOffset = 148;
+	}
+	if (!IsCompressed(textureData.Format))
+	{
+		log_fatal("%s isn't in a BC format\n", fileName);
+		exit(1);
+	}
+	
+	// The levels are already stored from largest to smallest with no padding between them
+	for (unsigned int i = 0; i < textureData.MipLevels; i++)
+	{
+		textureData.Size += TransferGetLevelSize((VkFormat)textureData.Format, MAX(textureData.Width >> i, 1), MAX(textureData.Height >> i, 1));
+	}
+	if (textureData.Size > size - dataOffset)
+	{
+		log_fatal("%s is truncated\n", fileName);
+		exit(1);
+	}
+	textureData.Pixels = malloc(textureData.Size);
+	memcpy(textureData.Pixels, data + dataOffset, textureData.Size);
+	return textureData;
+}
+
 TextureData TextureDataFromFile(const char * fileName)
 {	
 	File file = FileOpen(fileName, FileModeReadBinary);
@@ -15,6 +176,19 @@ TextureData TextureDataFromFile(const char * fileName)
 	FileRead(file, 0, size, data);
 	FileClose(file);
 	
+	if (size >= sizeof(KTX2Identifier) && memcmp(data, KTX2Identifier, sizeof(KTX2Identifier)) == 0)
+	{
+		TextureData textureData = LoadKTX2(fileName, data, size);
+		free(data);
+		return textureData;
+	}
+	if (size >= 4 && memcmp(data, "DDS ", 4) == 0)
+	{
+		TextureData textureData = LoadDDS(fileName, data, size);
+		free(data);
+		return textureData;
+	}
+	
 	int width, height, channels;
 	stbi_uc * pixels = stbi_load_from_memory(data, (int)size, &width, &height, &channels, STBI_rgb_alpha);
 	if (pixels == NULL)
@@ -29,17 +203,104 @@ TextureData TextureDataFromFile(const char * fileName)
 		.Width = width,
 		.Height = height,
 		.Pixels = pixels,
+		.Format = TextureFormatColor,
+		.MipLevels = 1,
+		.Size = (size_t)width * height * 4,
 	};
 }
+
+typedef struct TextureLoad
+{
+	const char * File;
+	TextureData * Data;
+	TextureConfigure Config;
+	Texture * Texture;
+} TextureLoad;
+
+static void LoadTextureJob(void * data)
+{
+	TextureLoad * load = data;
+	TextureData textureData = TextureDataFromFile(load->File);
+	if (load->Texture == NULL)
+	{
+		*load->Data = textureData;
+		return;
+	}
+	// The decoded pixels are freed once they're copied for upload. The staging copy is only reclaimed after the next frame completes,
+	// and files that don't fit in the staging ring get their own staging buffer, so a batch larger than the ring holds all of it until then
+	load->Config.LoadFromData = true;
+	load->Config.Data = textureData;
+	*load->Texture = TextureCreateAsync(load->Config);
+	TextureDataDestroy(textureData);
+}
+
+static void LoadTextures(const char ** files, int count, TextureData * data, TextureConfigure config, Texture * textures)
+{
+	TextureLoad * loads = malloc(count * sizeof(TextureLoad));
+	Job * jobs = malloc(count * sizeof(Job));
+	for (int i = 0; i < count; i++)
+	{
+		loads[i] = (TextureLoad)
+		{
+			.File = files[i],
+			.Data = data == NULL ? NULL : &data[i],
+			.Config = config,
+			.Texture = textures == NULL ? NULL : &textures[i],
+		};
+		jobs[i] = JobSubmit(LoadTextureJob, &loads[i]);
+	}
+	// The calling thread decodes queued images while it waits
+	for (int i = 0; i < count; i++) { JobDestroy(jobs[i]); }
+	free(jobs);
+	free(loads);
+}
+
+void TextureDataFromFiles(const char ** files, int count, TextureData * data)
+{
+	LoadTextures(files, count, data, (TextureConfigure){ 0 }, NULL);
+}
+
+TextureData TextureDataCombineLayers(TextureData * layers, int count)
+{
+	TextureData combined = layers[0];
+	combined.MipLevels = MAX(combined.MipLevels, 1);
+	size_t layerSize = combined.Size > 0 ? combined.Size : (size_t)combined.Width * combined.Height * 4;
+	for (int i = 0; i < count; i++)
+	{
+		TextureData layer = layers[i];
+		size_t size = layer.Size > 0 ? layer.Size : (size_t)layer.Width * layer.Height * 4;
+		if (layer.Width != combined.Width || layer.Height != combined.Height || layer.Format != combined.Format ||
+			MAX(layer.MipLevels, 1) != combined.MipLevels || MAX(layer.Layers, 1) != 1 || size != layerSize)
+		{
+			log_fatal("Texture layer %i doesn't match the size, format and mip levels of the first layer\n", i);
+			exit(1);
+		}
+	}
+	combined.Layers = count;
+	combined.Size = layerSize * count;
+	combined.Pixels = malloc(combined.Size);
+	for (int i = 0; i < count; i++) { memcpy((unsigned char *)combined.Pixels + layerSize * i, layers[i].Pixels, layerSize); }
+	return combined;
+}
+
 void TextureDataDestroy(TextureData data)
 {
-	stbi_image_free(data.Pixels);
+	// stb_image allocates with malloc as well
+	free(data.Pixels);
+}
+
+// Color textures use the swapchain's format so that they can be copied to it
+static VkFormat GetVulkanFormat(TextureFormat format)
+{
+	return format == TextureFormatColor ? Graphics.Swapchain.ColorFormat : (VkFormat)format;
 }
 
 static void CreateImage(Texture texture)
 {
-	VkFormat format = texture->Format == TextureFormatColor ? Graphics.Swapchain.ColorFormat : (VkFormat)texture->Format;
-	VkImageUsageFlags usage = texture->Format == TextureFormatColor ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	VkFormat format = GetVulkanFormat(texture->Format);
+	VkImageUsageFlags usage = 0;
+	if (texture->Format == TextureFormatColor) { usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; }
+	if (texture->Format == TextureFormatDepthStencil) { usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; }
 	VkImageCreateInfo imageInfo =
 	{
 		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -51,8 +312,8 @@ static void CreateImage(Texture texture)
 			.height = texture->Height,
 			.depth = 1,
 		},
-		.mipLevels = 1,
-		.arrayLayers = 1,
+		.mipLevels = texture->MipLevels,
+		.arrayLayers = texture->Layers,
 		.samples = VK_SAMPLE_COUNT_1_BIT,
 		.tiling = VK_IMAGE_TILING_OPTIMAL,
 		.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | usage,
@@ -72,156 +333,107 @@ static void CreateImage(Texture texture)
 	}
 }
 
-static void TransitionImageLayout(Texture texture)
+static bool SupportsLinearBlit(VkFormat format)
 {
-	VkCommandBuffer commandBuffer;
-	VkCommandBufferAllocateInfo commandAllocateInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandPool = Graphics.CommandPool,
-		.commandBufferCount = 1,
-	};
-	vkAllocateCommandBuffers(Graphics.Device, &commandAllocateInfo, &commandBuffer);
-	VkCommandBufferBeginInfo beginInfo =
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(Graphics.PhysicalDevice, format, &properties);
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (properties.optimalTilingFeatures & required) == required;
+}
+
+// Averages four RGBA8 pixels with rounding, two channels at a time are kept in 16 bit lanes of one integer
+static uint32_t BoxFilter(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+	uint32_t low = (a & 0x00FF00FF) + (b & 0x00FF00FF) + (c & 0x00FF00FF) + (d & 0x00FF00FF) + 0x00020002;
+	uint32_t high = ((a >> 8) & 0x00FF00FF) + ((b >> 8) & 0x00FF00FF) + ((c >> 8) & 0x00FF00FF) + ((d >> 8) & 0x00FF00FF) + 0x00020002;
+	return ((low >> 2) & 0x00FF00FF) | (((high >> 2) & 0x00FF00FF) << 8);
+}
+
+// Fills in the levels after the first one, they're packed one after another
+static void FilterMipChain(uint32_t * chain, unsigned int width, unsigned int height, unsigned int mipLevels)
+{
+	uint32_t * source = chain;
+	for (unsigned int i = 1; i < mipLevels; i++)
 	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-	};
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
-	
-	VkImageAspectFlags imageAspect = texture->Format == TextureFormatColor ? VK_IMAGE_ASPECT_COLOR_BIT : VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
-	VkImageMemoryBarrier barrier =
-	{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.newLayout = VK_IMAGE_LAYOUT_GENERAL,
-		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.image = texture->Image,
-		.subresourceRange =
+		unsigned int levelWidth = MAX(width / 2, 1), levelHeight = MAX(height / 2, 1);
+		uint32_t * level = source + width * height;
+		for (unsigned int y = 0; y < levelHeight; y++)
 		{
-			.aspectMask = imageAspect,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1,
-		},
-	};
-	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
-	vkEndCommandBuffer(commandBuffer);
-	
-	VkFence fence;
-	VkFenceCreateInfo fenceInfo = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
-	vkCreateFence(Graphics.Device, &fenceInfo, NULL, &fence);
-	VkSubmitInfo submitInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &commandBuffer,
-	};
-	vkQueueSubmit(Graphics.GraphicsQueue, 1, &submitInfo, fence);
-	vkWaitForFences(Graphics.Device, 1, &fence, VK_TRUE, UINT64_MAX);
-	vkDestroyFence(Graphics.Device, fence, NULL);
-	vkFreeCommandBuffers(Graphics.Device, Graphics.CommandPool, 1, &commandBuffer);
+			uint32_t * row0 = source + MIN(y * 2, height - 1) * width;
+			uint32_t * row1 = source + MIN(y * 2 + 1, height - 1) * width;
+			for (unsigned int x = 0; x < levelWidth; x++)
+			{
+				unsigned int x0 = MIN(x * 2, width - 1), x1 = MIN(x * 2 + 1, width - 1);
+				level[y * levelWidth + x] = BoxFilter(row0[x0], row0[x1], row1[x0], row1[x1]);
+			}
+		}
+		source = level;
+		width = levelWidth;
+		height = levelHeight;
+	}
 }
 
-static void CopyImageData(Texture texture, TextureConfigure config)
+// Builds every mip level of every layer on the cpu for formats that can't be blitted
+static uint32_t * CreateMipChain(TextureData data, unsigned int mipLevels, unsigned int layers, size_t * size)
 {
-	texture->Width = config.Data.Width;
-	texture->Height = config.Data.Height;
-	unsigned int size = texture->Width * texture->Height * 4;
-	
-	VkBuffer stagingBuffer;
-	VmaAllocation stagingAllocation;
-	VkBufferCreateInfo stagingInfo =
+	size_t layerSize = 0;
+	for (unsigned int i = 0; i < mipLevels; i++) { layerSize += (size_t)MAX(data.Width >> i, 1) * MAX(data.Height >> i, 1) * 4; }
+	*size = layerSize * layers;
+	uint32_t * chain = malloc(*size);
+	for (unsigned int i = 0; i < layers; i++)
 	{
-		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		.size = size,
-		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-	};
-	VmaAllocationCreateInfo stagingAllocationInfo =
-	{
-		.usage = VMA_MEMORY_USAGE_CPU_ONLY,
-	};
-	vmaCreateBuffer(Graphics.Allocator, &stagingInfo, &stagingAllocationInfo, &stagingBuffer, &stagingAllocation, NULL);
-	
-	void * data;
-	vmaMapMemory(Graphics.Allocator, stagingAllocation, &data);
-	memcpy(data, config.Data.Pixels, size);
-	vmaUnmapMemory(Graphics.Allocator, stagingAllocation);
-	
-	VkCommandBuffer commandBuffer;
-	VkCommandBufferAllocateInfo commandAllocateInfo =
+		uint32_t * layer = chain + layerSize / 4 * i;
+		memcpy(layer, (uint32_t *)data.Pixels + (size_t)data.Width * data.Height * i, (size_t)data.Width * data.Height * 4);
+		FilterMipChain(layer, data.Width, data.Height, mipLevels);
+	}
+	return chain;
+}
+
+static void UploadImageData(Texture texture, TextureConfigure config)
+{
+	VkFormat format = GetVulkanFormat(texture->Format);
+	TransferImage upload =
 	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandPool = Graphics.CommandPool,
-		.commandBufferCount = 1,
+		.Image = texture->Image,
+		.Format = format,
+		.Width = texture->Width,
+		.Height = texture->Height,
+		.MipLevels = texture->MipLevels,
+		.Layers = texture->Layers,
+		.GenerateMipmaps = texture->MipLevels > MAX(config.Data.MipLevels, 1),
+		.Pixels = config.Data.Pixels,
+		.Size = config.Data.Size > 0 ? config.Data.Size : (size_t)texture->Width * texture->Height * 4 * texture->Layers,
 	};
-	vkAllocateCommandBuffers(Graphics.Device, &commandAllocateInfo, &commandBuffer);
-	VkCommandBufferBeginInfo beginInfo =
+	if (!upload.GenerateMipmaps || SupportsLinearBlit(format))
 	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-	};
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
-	
-	VkBufferImageCopy copy =
-	{
-		.bufferOffset = 0,
-		.bufferImageHeight = 0,
-		.bufferRowLength = 0,
-		.imageOffset = { 0, 0, 0 },
-		.imageExtent = { texture->Width, texture->Height, 1 },
-		.imageSubresource =
-		{
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.mipLevel = 0,
-			.baseArrayLayer = 0,
-			.layerCount = 1,
-		}
-	};
-	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, texture->Image, VK_IMAGE_LAYOUT_GENERAL, 1, &copy);
-	
-	vkEndCommandBuffer(commandBuffer);
-	VkSubmitInfo submitInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &commandBuffer,
-		.signalSemaphoreCount = 0,
-		.pSignalSemaphores = NULL,
-	};
-	VkFence fence;
-	VkFenceCreateInfo fenceInfo = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
-	vkCreateFence(Graphics.Device, &fenceInfo, NULL, &fence);
-	vkQueueSubmit(Graphics.GraphicsQueue, 1, &submitInfo, fence);
+		texture->Ticket = TransferUploadImage(upload);
+		return;
+	}
 	
-	vkWaitForFences(Graphics.Device, 1, &fence, VK_TRUE, UINT64_MAX);
-	vkDestroyFence(Graphics.Device, fence, NULL);
-	vkFreeCommandBuffers(Graphics.Device, Graphics.CommandPool, 1, &commandBuffer);
-	vmaDestroyBuffer(Graphics.Allocator, stagingBuffer, stagingAllocation);
+	uint32_t * chain = CreateMipChain(config.Data, texture->MipLevels, texture->Layers, &upload.Size);
+	upload.GenerateMipmaps = false;
+	upload.Pixels = chain;
+	texture->Ticket = TransferUploadImage(upload);
+	free(chain);
 }
 
 static void CreateImageView(Texture texture)
 {
-	VkImageAspectFlags imageAspect = texture->Format == TextureFormatColor ? VK_IMAGE_ASPECT_COLOR_BIT : VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
-	VkFormat format = texture->Format == TextureFormatColor ? Graphics.Swapchain.ColorFormat : (VkFormat)texture->Format;
+	VkImageAspectFlags imageAspect = texture->Format == TextureFormatDepthStencil ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+	VkFormat format = GetVulkanFormat(texture->Format);
 	VkImageViewCreateInfo createInfo =
 	{
 		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
 		.image = texture->Image,
-		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.viewType = texture->Layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D,
 		.format = format,
 		.subresourceRange =
 		{
 			.aspectMask = imageAspect,
 			.baseMipLevel = 0,
-			.levelCount = 1,
+			.levelCount = texture->MipLevels,
 			.baseArrayLayer = 0,
-			.layerCount = 1,
+			.layerCount = texture->Layers,
 		},
 	};
 	VkResult result = vkCreateImageView(Graphics.Device, &createInfo, NULL, &texture->ImageView);
@@ -234,6 +446,7 @@ static void CreateImageView(Texture texture)
 
 static void CreateSampler(Texture texture, TextureConfigure config)
 {
+	float anisotropy = MIN(MAX(config.Anisotropy, 1.0f), Graphics.MaxSamplerAnisotropy);
 	VkSamplerCreateInfo samplerInfo =
 	{
 		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
@@ -243,7 +456,10 @@ static void CreateSampler(Texture texture, TextureConfigure config)
 		.addressModeU = (VkSamplerAddressMode)config.AddressMode,
 		.addressModeV = (VkSamplerAddressMode)config.AddressMode,
 		.addressModeW = (VkSamplerAddressMode)config.AddressMode,
-		.anisotropyEnable = VK_FALSE,
+		.anisotropyEnable = anisotropy > 1.0f,
+		.maxAnisotropy = anisotropy,
+		.minLod = 0.0f,
+		.maxLod = texture->MipLevels,
 		.compareEnable = VK_FALSE,
 		.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
 		.unnormalizedCoordinates = VK_FALSE,
@@ -256,32 +472,78 @@ static void CreateSampler(Texture texture, TextureConfigure config)
 	}
 }
 
-Texture TextureCreate(TextureConfigure config)
+Texture TextureCreateAsync(TextureConfigure config)
 {
 	Texture texture = malloc(sizeof(struct Texture));
 	*texture = (struct Texture)
 	{
 		.Width = config.LoadFromData ? config.Data.Width : config.Width,
 		.Height = config.LoadFromData ? config.Data.Height : config.Height,
-		.Format = config.Format,
+		.Format = config.LoadFromData ? config.Data.Format : config.Format,
+		.MipLevels = config.LoadFromData ? MAX(config.Data.MipLevels, 1) : 1,
+		.Layers = config.LoadFromData ? MAX(config.Data.Layers, 1) : 1,
+		.Ticket = 0,
 	};
+	if (IsCompressed(texture->Format) && !Graphics.TextureCompressionBC)
+	{
+		log_fatal("The graphics device doesn't support BC compressed textures\n");
+		exit(1);
+	}
+	// Block-compressed formats can't be blitted or box filtered, their levels have to come with the data
+	if (config.LoadFromData && config.GenerateMipmaps && texture->MipLevels == 1 && !IsCompressed(texture->Format))
+	{
+		while (MAX(texture->Width, texture->Height) >> texture->MipLevels > 0) { texture->MipLevels++; }
+	}
 	
 	CreateImage(texture);
-	TransitionImageLayout(texture);
-	if (config.LoadFromData) { CopyImageData(texture, config); }
+	if (config.LoadFromData) { UploadImageData(texture, config); }
+	else
+	{
+		// The graphics queue sets the layout when it acquires the next uploads, so nothing is submitted from this thread
+		VkImageAspectFlags aspect = texture->Format == TextureFormatDepthStencil ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+		texture->Ticket = TransferTransitionImage(texture->Image, aspect);
+	}
 	CreateImageView(texture);
 	CreateSampler(texture, config);
+	// The depth-stencil view has both aspects so it can't be sampled, and array views can't be sampled through the table's sampler2D
+	bool bindless = texture->Format != TextureFormatDepthStencil && texture->Layers == 1;
+	texture->Index = bindless ? BindlessAddTexture(texture->ImageView, texture->Sampler) : -1;
 	
 	return texture;
 }
 
+void TextureCreateFromFiles(const char ** files, int count, TextureConfigure config, Texture * textures)
+{
+	LoadTextures(files, count, NULL, config, textures);
+}
+
+Texture TextureCreate(TextureConfigure config)
+{
+	Texture texture = TextureCreateAsync(config);
+	TextureWait(texture);
+	return texture;
+}
+
+bool TextureIsReady(Texture texture)
+{
+	return TransferIsComplete(texture->Ticket);
+}
+
+void TextureWait(Texture texture)
+{
+	TransferWait(texture->Ticket);
+}
+
 void TextureQueueDestroy(Texture texture)
 {
-	ListPush(Graphics.FrameResources[Graphics.FrameIndex].DestroyTextureQueue, texture);
+	GraphicsQueueDestroy(GraphicsDestroyTypeTexture, texture);
 }
 
 void TextureDestroy(Texture texture)
 {
+	// The transfer queue could still be writing to the image
+	TransferWait(texture->Ticket);
+	BindlessRemoveTexture(texture->Index);
 	vkDestroySampler(Graphics.Device, texture->Sampler, NULL);
 	vkDestroyImageView(Graphics.Device, texture->ImageView, NULL);
 	vmaDestroyImage(Graphics.Allocator, texture->Image, texture->Allocation);
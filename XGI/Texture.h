@@ -3,31 +3,77 @@
 
 #include <vulkan/vulkan.h>
 #include <stdbool.h>
+#include "Transfer.h"
+
+typedef enum TextureFormat
+{
+	/// Used for creating a color texture
+	TextureFormatColor,
+	/// Used for creating a depth-stencil texture
+	TextureFormatDepthStencil = VK_FORMAT_D32_SFLOAT_S8_UINT,
+	/// Block-compressed formats, they can only be loaded from data and need the device to support BC compression.
+	/// RGB with 1 bit alpha, 8 bytes per a 4x4 block
+	TextureFormatBC1 = VK_FORMAT_BC1_RGBA_UNORM_BLOCK,
+	TextureFormatBC1SRGB = VK_FORMAT_BC1_RGBA_SRGB_BLOCK,
+	/// RGBA with explicit 4 bit alpha, 16 bytes per a block
+	TextureFormatBC2 = VK_FORMAT_BC2_UNORM_BLOCK,
+	TextureFormatBC2SRGB = VK_FORMAT_BC2_SRGB_BLOCK,
+	/// RGBA with interpolated alpha, 16 bytes per a block
+	TextureFormatBC3 = VK_FORMAT_BC3_UNORM_BLOCK,
+	TextureFormatBC3SRGB = VK_FORMAT_BC3_SRGB_BLOCK,
+	/// One channel, 8 bytes per a block
+	TextureFormatBC4 = VK_FORMAT_BC4_UNORM_BLOCK,
+	/// Two channels (normal maps), 16 bytes per a block
+	TextureFormatBC5 = VK_FORMAT_BC5_UNORM_BLOCK,
+	/// HDR RGB, 16 bytes per a block
+	TextureFormatBC6H = VK_FORMAT_BC6H_UFLOAT_BLOCK,
+	/// High quality RGBA, 16 bytes per a block
+	TextureFormatBC7 = VK_FORMAT_BC7_UNORM_BLOCK,
+	TextureFormatBC7SRGB = VK_FORMAT_BC7_SRGB_BLOCK,
+} TextureFormat;
 
 typedef struct TextureData
 {
 	unsigned int Width, Height;
 	void * Pixels;
+	/// TextureFormatColor for RGBA8 pixels, otherwise one of the block-compressed formats
+	TextureFormat Format;
+	/// The number of mip levels in the pixels, they're packed one after another. 0 is treated as 1
+	unsigned int MipLevels;
+	/// The number of array layers in the pixels, 0 is treated as 1. Each layer's mip levels come before the next layer's
+	unsigned int Layers;
+	/// The size of the pixels in bytes, 0 is treated as Width * Height * 4 * Layers
+	size_t Size;
 } TextureData;
 
-/// Creates a texture data object from an image file
+/// Creates a texture data object from an image file.
+/// KTX2 and DDS files with block-compressed formats are loaded as they are, including their mip levels.
+/// Anything else is decoded to RGBA8 with stb_image
 /// \param file The path to the image
 /// \return The texturedata object
 TextureData TextureDataFromFile(const char * file);
 
+/// Creates texture data objects from many image files at once.
+/// The files are read and decoded in parallel on the worker threads, this blocks until all of them are loaded
+/// \param files The paths to the images
+/// \param count The number of images
+/// \param data The array that count texturedata objects are written to
+void TextureDataFromFiles(const char ** files, int count, TextureData * data);
+
+/// Packs texture datas of the same size, format and mip levels into the layers of one texture data for creating an array texture.
+/// Array textures are sampled with sampler2DArray and the layer as the third coordinate, so draws using different layers can share descriptors.
+/// This is the way to index textures in shaders if the device doesn't support the bindless texture table.
+/// The layers aren't destroyed
+/// \param layers The texture datas to pack in order
+/// \param count The number of layers
+/// \return The texturedata object containing every layer
+TextureData TextureDataCombineLayers(TextureData * layers, int count);
+
 /// Destroys and frees a texture data object.
 /// (It's important to do this, those texture datas are uncompressed and take a lot of memory)
 /// \param data The texture data to free
 void TextureDataDestroy(TextureData data);
 
-typedef enum TextureFormat
-{
-	/// Used for creating a color texture
-	TextureFormatColor,
-	/// Used for creating a depth-stencil texture
-	TextureFormatDepthStencil = VK_FORMAT_D32_SFLOAT_S8_UINT,
-} TextureFormat;
-
 typedef enum TextureFilter
 {
 	/// Linearly interpolates sampling when the texture is scaled up
@@ -57,7 +103,7 @@ typedef struct TextureConfigure
 	/// Ignored if LoadFromData is true
 	unsigned int Height;
 	/// The type of texture (color or depth-stencil).
-	/// Assumed to be color texture if LoadFromData is true
+	/// Ignored if LoadFromData is true, the format of the data is used instead
 	TextureFormat Format;
 	/// The sampling filter to use
 	TextureFilter Filter;
@@ -67,23 +113,67 @@ typedef struct TextureConfigure
 	bool LoadFromData;
 	/// The texture data object used if LoadFromData is true
 	TextureData Data;
+	/// Whether or not to create a full mip chain for the texture so it doesn't alias when scaled down.
+	/// The levels are blitted on the gpu, or box filtered on the cpu if the format can't be blitted.
+	/// Ignored if LoadFromData is false or the data is block-compressed
+	bool GenerateMipmaps;
+	/// The number of samples used for anisotropic filtering, it's clamped to what the device supports.
+	/// 0 or 1 disables it, 16 is the usual maximum
+	float Anisotropy;
 } TextureConfigure;
 
 typedef struct Texture
 {
 	unsigned int Width, Height;
+	unsigned int MipLevels;
+	unsigned int Layers;
 	TextureFormat Format;
 	VkImage Image;
 	VmaAllocation Allocation;
 	VkImageView ImageView;
 	VkSampler Sampler;
+	TransferTicket Ticket;
+	/// The index of the texture in the bindless texture table for shaders to sample with, it doesn't change for the lifetime of the texture.
+	/// -1 for depth-stencil and array textures (the table only holds sampler2D views), or if the device doesn't support descriptor indexing or the table is full
+	int Index;
 } * Texture;
 
-/// Creates a texture object from a configuration
+/// Creates a texture object from a configuration.
+/// This blocks until the texture data has been uploaded, and must be called on the render thread
 /// \param config The configuration to create from
 /// \return The texture object created
 Texture TextureCreate(TextureConfigure config);
 
+/// Creates a texture object from a configuration without waiting for its data to be uploaded.
+/// The data is copied on the transfer queue in the background, the texture can't be rendered with until TextureIsReady.
+/// Textures without data are ready once the graphics queue has set their layout with the next uploads.
+/// The texture data can be destroyed as soon as this returns. This can be called from any thread
+/// \param config The configuration to create from
+/// \return The texture object created
+Texture TextureCreateAsync(TextureConfigure config);
+
+/// Creates texture objects from many image files at once without waiting for their data to be uploaded.
+/// The files are decoded in parallel on the worker threads and each one is copied for upload as soon as it's decoded.
+/// The staging copies are held until the frame after this call completes, so loads much larger than the staging ring should be split across frames.
+/// This blocks until every file is decoded.
+/// This can be called from any thread
+/// \param files The paths to the images
+/// \param count The number of images
+/// \param config The configuration every texture is created with, LoadFromData and Data are ignored
+/// \param textures The array that count texture objects are written to
+void TextureCreateFromFiles(const char ** files, int count, TextureConfigure config, Texture * textures);
+
+/// Checks if the data of a texture created with TextureCreateAsync can be used yet.
+/// Textures are ready at the latest once the next frame has been acquired
+/// \param texture The texture to check
+/// \return Whether or not the texture is ready
+bool TextureIsReady(Texture texture);
+
+/// Blocks until the data of a texture has been uploaded.
+/// This must be called on the render thread
+/// \param texture The texture to wait for
+void TextureWait(Texture texture);
+
 /// Places the texture into a queue to be destroyed.
 /// This should only be called if the texture needs to be destroyed at render-time
 /// \param texture The texture to destroy
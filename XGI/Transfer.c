@@ -0,0 +1,832 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <SDL2/SDL_mutex.h>
+#include <vk_mem_alloc.h>
+#include "Transfer.h"
+#include "Graphics.h"
+#include "List.h"
+#include "log.h"
+
+typedef enum TransferBatchState
+{
+	TransferBatchStateFree,
+	TransferBatchStateRecording,
+	TransferBatchStateSubmitted,
+	TransferBatchStateAcquired,
+} TransferBatchState;
+
+// An allocation from the staging ring or a dedicated buffer, the frame is INT_MAX until it's released
+struct TransferStagingEntry
+{
+	int Frame;
+	unsigned long long Sequence;
+	unsigned long long Start;
+	unsigned long long End;
+	VkBuffer DedicatedBuffer;
+	VmaAllocation DedicatedAllocation;
+};
+
+// One submission to the transfer queue, it's reused once the graphics queue has acquired its images and finished with its semaphore
+struct TransferBatch
+{
+	TransferBatchState State;
+	TransferTicket Ticket;
+	VkCommandBuffer CommandBuffer;
+	VkFence Fence;
+	VkSemaphore Semaphore;
+	// The frame that waited on the semaphore, -1 if TransferWait did
+	int AcquireFrame;
+	VkImageMemoryBarrier * Acquires;
+	int AcquireCount;
+	int AcquireCapacity;
+	// The uploads that need their mip levels blitted after being acquired
+	TransferImage * Mipmaps;
+	int MipmapCount;
+	// The images without data, their layouts are set by the graphics queue when the batch is acquired
+	VkImageMemoryBarrier * Transitions;
+	int TransitionCount;
+	int TransitionCapacity;
+};
+
+// Buffer uploads made during a frame, submitted together right before the frame's commands
+struct TransferUploadBatch
+{
+	VkCommandBuffer CommandBuffer;
+	// The frame the batch was submitted with, INT_MAX while it's recording
+	int Frame;
+};
+
+static struct Transfer
+{
+	SDL_mutex * Mutex;
+	VkCommandPool CommandPool;
+	List Batches;
+	struct TransferBatch * Recording;
+	TransferTicket NextTicket;
+	// Every upload up to and including this ticket has been acquired by the graphics queue
+	TransferTicket AcquiredTicket;
+	
+	// Head and Tail only ever increase, the position in the buffer is their remainder of Capacity
+	struct TransferStagingRing
+	{
+		VkBuffer Buffer;
+		VmaAllocation Allocation;
+		unsigned char * Data;
+		VkDeviceSize Capacity;
+		VkDeviceSize Alignment;
+		unsigned long long Head;
+		unsigned long long Tail;
+		// A queue of allocations in the order they were made, entry n is at Entries[n % EntryCapacity]
+		struct TransferStagingEntry * Entries;
+		int EntryCapacity;
+		unsigned long long FirstEntry;
+		unsigned long long NextEntry;
+		// Allocations that were still held when they reached the front of the queue, they're moved here so they don't stop the
+		// allocations after them from being reclaimed. Their ring memory is skipped over until they're released and finished
+		struct TransferStagingEntry * Held;
+		int HeldCount;
+		int HeldCapacity;
+	} Staging;
+	
+	VkCommandPool UploadPool;
+	List UploadBatches;
+	struct TransferUploadBatch * Uploading;
+	unsigned long long UploadSequence;
+} Transfer = { 0 };
+
+static void CreateStagingRing(int size)
+{
+	if (size <= 0) { size = 16 * 1024 * 1024; }
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(Graphics.PhysicalDevice, &properties);
+	struct TransferStagingRing * ring = &Transfer.Staging;
+	*ring = (struct TransferStagingRing)
+	{
+		.Capacity = size,
+		.Alignment = MAX(properties.limits.optimalBufferCopyOffsetAlignment, 16),
+		.EntryCapacity = 256,
+	};
+	ring->Entries = malloc(ring->EntryCapacity * sizeof(struct TransferStagingEntry));
+	
+	VkBufferCreateInfo bufferInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = size,
+		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+	};
+	VmaAllocationCreateInfo allocationInfo =
+	{
+		.usage = VMA_MEMORY_USAGE_CPU_ONLY,
+		.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+	};
+	VmaAllocationInfo info;
+	VkResult result = vmaCreateBuffer(Graphics.Allocator, &bufferInfo, &allocationInfo, &ring->Buffer, &ring->Allocation, &info);
+	if (result != VK_SUCCESS)
+	{
+		log_fatal("Failed to create the staging ring: %i\n", result);
+		exit(1);
+	}
+	ring->Data = info.pMappedData;
+}
+
+void TransferInitialize(int stagingRingSize)
+{
+	VkCommandPoolCreateInfo createInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = Graphics.TransferQueueIndex,
+	};
+	VkResult result = vkCreateCommandPool(Graphics.Device, &createInfo, NULL, &Transfer.CommandPool);
+	if (result != VK_SUCCESS)
+	{
+		log_fatal("Failed to create transfer command pool: %i\n", result);
+		exit(1);
+	}
+	createInfo.queueFamilyIndex = Graphics.GraphicsQueueIndex;
+	result = vkCreateCommandPool(Graphics.Device, &createInfo, NULL, &Transfer.UploadPool);
+	if (result != VK_SUCCESS)
+	{
+		log_fatal("Failed to create upload command pool: %i\n", result);
+		exit(1);
+	}
+	Transfer.Mutex = SDL_CreateMutex();
+	Transfer.Batches = ListCreate();
+	Transfer.UploadBatches = ListCreate();
+	Transfer.Uploading = NULL;
+	Transfer.Recording = NULL;
+	Transfer.NextTicket = 0;
+	Transfer.AcquiredTicket = 0;
+	CreateStagingRing(stagingRingSize);
+}
+
+// Frees the allocations whose frames have finished, the ones at the front of the queue that are still held are moved aside
+static void ReclaimStaging()
+{
+	struct TransferStagingRing * ring = &Transfer.Staging;
+	for (int i = 0; i < ring->HeldCount; i++)
+	{
+		struct TransferStagingEntry * entry = ring->Held + i;
+		if (entry->Frame > Graphics.CompletedFrame) { continue; }
+		if (entry->DedicatedBuffer != VK_NULL_HANDLE) { vmaDestroyBuffer(Graphics.Allocator, entry->DedicatedBuffer, entry->DedicatedAllocation); }
+		ring->HeldCount--;
+		ring->Held[i] = ring->Held[ring->HeldCount];
+		i--;
+	}
+	while (ring->FirstEntry != ring->NextEntry)
+	{
+		struct TransferStagingEntry * entry = ring->Entries + ring->FirstEntry % ring->EntryCapacity;
+		if (entry->Frame == INT_MAX)
+		{
+			if (ring->HeldCount == ring->HeldCapacity)
+			{
+				ring->HeldCapacity = MAX(ring->HeldCapacity * 2, 16);
+				ring->Held = realloc(ring->Held, ring->HeldCapacity * sizeof(struct TransferStagingEntry));
+			}
+			ring->Held[ring->HeldCount++] = *entry;
+		}
+		else if (entry->Frame > Graphics.CompletedFrame) { break; }
+		else if (entry->DedicatedBuffer != VK_NULL_HANDLE) { vmaDestroyBuffer(Graphics.Allocator, entry->DedicatedBuffer, entry->DedicatedAllocation); }
+		if (entry->DedicatedBuffer == VK_NULL_HANDLE) { ring->Tail = entry->End; }
+		ring->FirstEntry++;
+	}
+	if (ring->FirstEntry == ring->NextEntry) { ring->Tail = ring->Head; }
+}
+
+static struct TransferStagingEntry * PushStagingEntry()
+{
+	struct TransferStagingRing * ring = &Transfer.Staging;
+	if (ring->NextEntry - ring->FirstEntry == ring->EntryCapacity)
+	{
+		int capacity = ring->EntryCapacity * 2;
+		struct TransferStagingEntry * entries = malloc(capacity * sizeof(struct TransferStagingEntry));
+		for (unsigned long long i = ring->FirstEntry; i != ring->NextEntry; i++) { entries[i % capacity] = ring->Entries[i % ring->EntryCapacity]; }
+		free(ring->Entries);
+		ring->Entries = entries;
+		ring->EntryCapacity = capacity;
+	}
+	struct TransferStagingEntry * entry = ring->Entries + ring->NextEntry % ring->EntryCapacity;
+	*entry = (struct TransferStagingEntry){ .Frame = INT_MAX, .Sequence = ring->NextEntry };
+	ring->NextEntry++;
+	return entry;
+}
+
+// Returns false if the ring doesn't have room, allocations never wrap around the end of the buffer and skip over held regions
+static bool AllocateFromRing(size_t size, unsigned long long * start)
+{
+	struct TransferStagingRing * ring = &Transfer.Staging;
+	if (size > ring->Capacity) { return false; }
+	unsigned long long offset = (ring->Head + ring->Alignment - 1) / ring->Alignment * ring->Alignment;
+	bool moved = true;
+	while (moved)
+	{
+		moved = false;
+		if (offset % ring->Capacity + size > ring->Capacity) { offset = (offset / ring->Capacity + 1) * ring->Capacity; }
+		if (offset + size - ring->Tail > ring->Capacity) { return false; }
+		for (int i = 0; i < ring->HeldCount; i++)
+		{
+			struct TransferStagingEntry * held = ring->Held + i;
+			if (held->DedicatedBuffer != VK_NULL_HANDLE) { continue; }
+			// Where the held region is in the same pass over the buffer as the allocation
+			unsigned long long heldStart = offset / ring->Capacity * ring->Capacity + held->Start % ring->Capacity;
+			unsigned long long heldEnd = heldStart + held->End - held->Start;
+			if (offset < heldEnd && heldStart < offset + size)
+			{
+				offset = (heldEnd + ring->Alignment - 1) / ring->Alignment * ring->Alignment;
+				moved = true;
+			}
+		}
+	}
+	*start = offset;
+	ring->Head = offset + size;
+	return true;
+}
+
+TransferStaging TransferStagingAllocate(size_t size)
+{
+	struct TransferStagingRing * ring = &Transfer.Staging;
+	SDL_LockMutex(Transfer.Mutex);
+	unsigned long long start;
+	bool fits = AllocateFromRing(size, &start);
+	if (!fits)
+	{
+		ReclaimStaging();
+		fits = AllocateFromRing(size, &start);
+	}
+	
+	TransferStaging staging = { .Sequence = ring->NextEntry };
+	struct TransferStagingEntry * entry = PushStagingEntry();
+	if (fits)
+	{
+		entry->Start = start;
+		entry->End = ring->Head;
+		staging.Buffer = ring->Buffer;
+		staging.Offset = start % ring->Capacity;
+		staging.Data = ring->Data + staging.Offset;
+	}
+	else
+	{
+		VkBufferCreateInfo bufferInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = size,
+			.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		};
+		VmaAllocationCreateInfo allocationInfo =
+		{
+			.usage = VMA_MEMORY_USAGE_CPU_ONLY,
+			.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+		};
+		VmaAllocationInfo info;
+		VkResult result = vmaCreateBuffer(Graphics.Allocator, &bufferInfo, &allocationInfo, &entry->DedicatedBuffer, &entry->DedicatedAllocation, &info);
+		if (result != VK_SUCCESS)
+		{
+			log_fatal("Failed to create a staging buffer: %i\n", result);
+			exit(1);
+		}
+		entry->Start = ring->Head;
+		entry->End = ring->Head;
+		staging.Buffer = entry->DedicatedBuffer;
+		staging.Offset = 0;
+		staging.Data = info.pMappedData;
+	}
+	SDL_UnlockMutex(Transfer.Mutex);
+	return staging;
+}
+
+void TransferStagingRelease(TransferStaging staging)
+{
+	struct TransferStagingRing * ring = &Transfer.Staging;
+	SDL_LockMutex(Transfer.Mutex);
+	struct TransferStagingEntry * entry = NULL;
+	if (staging.Sequence >= ring->FirstEntry) { entry = ring->Entries + staging.Sequence % ring->EntryCapacity; }
+	for (int i = 0; entry == NULL && i < ring->HeldCount; i++)
+	{
+		if (ring->Held[i].Sequence == staging.Sequence) { entry = ring->Held + i; }
+	}
+	// Anything recorded now is submitted by the next frame at the latest
+	entry->Frame = SDL_AtomicGet(&Graphics.FrameNumber) + 1;
+	SDL_UnlockMutex(Transfer.Mutex);
+}
+
+static struct TransferBatch * CreateBatch()
+{
+	struct TransferBatch * batch = malloc(sizeof(struct TransferBatch));
+	*batch = (struct TransferBatch){ .State = TransferBatchStateFree };
+
+	VkCommandBufferAllocateInfo commandAllocateInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandPool = Transfer.CommandPool,
+		.commandBufferCount = 1,
+	};
+	vkAllocateCommandBuffers(Graphics.Device, &commandAllocateInfo, &batch->CommandBuffer);
+	VkFenceCreateInfo fenceInfo = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	vkCreateFence(Graphics.Device, &fenceInfo, NULL, &batch->Fence);
+	VkSemaphoreCreateInfo semaphoreInfo = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+	vkCreateSemaphore(Graphics.Device, &semaphoreInfo, NULL, &batch->Semaphore);
+
+	ListPush(Transfer.Batches, batch);
+	return batch;
+}
+
+// Batches can be reused once their copies are done and nothing can still be waiting on their semaphore
+static void ReclaimBatches()
+{
+	for (int i = 0; i < ListGetCount(Transfer.Batches); i++)
+	{
+		struct TransferBatch * batch = ListGetValue(Transfer.Batches, i);
+		if (batch->State != TransferBatchStateAcquired) { continue; }
+		if (batch->AcquireFrame > Graphics.CompletedFrame) { continue; }
+		if (vkGetFenceStatus(Graphics.Device, batch->Fence) != VK_SUCCESS) { continue; }
+
+		vkResetFences(Graphics.Device, 1, &batch->Fence);
+		vkResetCommandBuffer(batch->CommandBuffer, 0);
+		batch->AcquireCount = 0;
+		batch->MipmapCount = 0;
+		batch->TransitionCount = 0;
+		batch->State = TransferBatchStateFree;
+	}
+}
+
+static struct TransferBatch * GetRecordingBatch()
+{
+	if (Transfer.Recording != NULL) { return Transfer.Recording; }
+
+	ReclaimBatches();
+	struct TransferBatch * batch = NULL;
+	for (int i = 0; i < ListGetCount(Transfer.Batches) && batch == NULL; i++)
+	{
+		struct TransferBatch * candidate = ListGetValue(Transfer.Batches, i);
+		if (candidate->State == TransferBatchStateFree) { batch = candidate; }
+	}
+	if (batch == NULL) { batch = CreateBatch(); }
+
+	VkCommandBufferBeginInfo beginInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	};
+	vkBeginCommandBuffer(batch->CommandBuffer, &beginInfo);
+	batch->State = TransferBatchStateRecording;
+	batch->Ticket = ++Transfer.NextTicket;
+	Transfer.Recording = batch;
+	return batch;
+}
+
+static void SubmitRecordingBatch()
+{
+	struct TransferBatch * batch = Transfer.Recording;
+	if (batch == NULL) { return; }
+
+	vkEndCommandBuffer(batch->CommandBuffer);
+	VkSubmitInfo submitInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &batch->CommandBuffer,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &batch->Semaphore,
+	};
+	VkResult result = vkQueueSubmit(Graphics.TransferQueue, 1, &submitInfo, batch->Fence);
+	SDL_AtomicAdd(&Graphics.Statistics.QueueSubmits, 1);
+	if (result != VK_SUCCESS)
+	{
+		log_fatal("Failed to submit transfer queue: %i\n", result);
+		exit(1);
+	}
+	batch->State = TransferBatchStateSubmitted;
+	Transfer.Recording = NULL;
+}
+
+size_t TransferGetLevelSize(VkFormat format, unsigned int width, unsigned int height)
+{
+	if (format < VK_FORMAT_BC1_RGB_UNORM_BLOCK || format > VK_FORMAT_BC7_SRGB_BLOCK) { return (size_t)width * height * 4; }
+	// Block-compressed formats store every 4x4 block in 8 or 16 bytes, partial blocks are padded
+	bool halfBlock = format <= VK_FORMAT_BC1_RGBA_SRGB_BLOCK || format == VK_FORMAT_BC4_UNORM_BLOCK || format == VK_FORMAT_BC4_SNORM_BLOCK;
+	return (((size_t)width + 3) / 4) * (((size_t)height + 3) / 4) * (halfBlock ? 8 : 16);
+}
+
+TransferTicket TransferUploadImage(TransferImage upload)
+{
+	TransferStaging staging = TransferStagingAllocate(upload.Size);
+	memcpy(staging.Data, upload.Pixels, upload.Size);
+
+	SDL_LockMutex(Transfer.Mutex);
+	struct TransferBatch * batch = GetRecordingBatch();
+	upload.Layers = MAX(upload.Layers, 1);
+
+	VkImageMemoryBarrier barrier =
+	{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = upload.Image,
+		.subresourceRange =
+		{
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = upload.MipLevels,
+			.baseArrayLayer = 0,
+			.layerCount = upload.Layers,
+		},
+	};
+	vkCmdPipelineBarrier(batch->CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+	// Every layer's levels are packed one after another before the next layer
+	unsigned int levelCount = upload.GenerateMipmaps ? 1 : upload.MipLevels;
+	unsigned int copyCount = levelCount * upload.Layers;
+	VkBufferImageCopy * copies = malloc(copyCount * sizeof(VkBufferImageCopy));
+	VkDeviceSize offset = staging.Offset;
+	for (unsigned int c = 0; c < copyCount; c++)
+	{
+		unsigned int i = c % levelCount;
+		unsigned int width = MAX(upload.Width >> i, 1);
+		unsigned int height = MAX(upload.Height >> i, 1);
+		copies[c] = (VkBufferImageCopy)
+		{
+			.bufferOffset = offset,
+			.bufferImageHeight = 0,
+			.bufferRowLength = 0,
+			.imageOffset = { 0, 0, 0 },
+			.imageExtent = { width, height, 1 },
+			.imageSubresource =
+			{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = i,
+				.baseArrayLayer = c / levelCount,
+				.layerCount = 1,
+			}
+		};
+		offset += TransferGetLevelSize(upload.Format, width, height);
+	}
+	vkCmdCopyBufferToImage(batch->CommandBuffer, staging.Buffer, upload.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copyCount, copies);
+	free(copies);
+
+	// The release half of the ownership transfer, the graphics queue records the matching acquire before using the image.
+	// Without a separate transfer family only the semaphore and an execution barrier are needed.
+	// Images that need mipmaps stay as transfer destinations since only the graphics queue can blit
+	bool ownershipTransfer = Graphics.TransferQueueIndex != Graphics.GraphicsQueueIndex;
+	VkImageLayout layout = upload.GenerateMipmaps ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = layout;
+	barrier.srcQueueFamilyIndex = ownershipTransfer ? Graphics.TransferQueueIndex : VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = ownershipTransfer ? Graphics.GraphicsQueueIndex : VK_QUEUE_FAMILY_IGNORED;
+	vkCmdPipelineBarrier(batch->CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = upload.GenerateMipmaps ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+	if (!ownershipTransfer) { barrier.oldLayout = layout; }
+	if (batch->AcquireCount == batch->AcquireCapacity)
+	{
+		batch->AcquireCapacity = batch->AcquireCapacity == 0 ? 8 : batch->AcquireCapacity * 2;
+		batch->Acquires = realloc(batch->Acquires, batch->AcquireCapacity * sizeof(VkImageMemoryBarrier));
+		batch->Mipmaps = realloc(batch->Mipmaps, batch->AcquireCapacity * sizeof(TransferImage));
+	}
+	batch->Acquires[batch->AcquireCount++] = barrier;
+	upload.Pixels = NULL;
+	if (upload.GenerateMipmaps) { batch->Mipmaps[batch->MipmapCount++] = upload; }
+
+	TransferTicket ticket = batch->Ticket;
+	SDL_UnlockMutex(Transfer.Mutex);
+	TransferStagingRelease(staging);
+	return ticket;
+}
+
+TransferTicket TransferTransitionImage(VkImage image, VkImageAspectFlags aspect)
+{
+	SDL_LockMutex(Transfer.Mutex);
+	struct TransferBatch * batch = GetRecordingBatch();
+	if (batch->TransitionCount == batch->TransitionCapacity)
+	{
+		batch->TransitionCapacity = batch->TransitionCapacity == 0 ? 8 : batch->TransitionCapacity * 2;
+		batch->Transitions = realloc(batch->Transitions, batch->TransitionCapacity * sizeof(VkImageMemoryBarrier));
+	}
+	batch->Transitions[batch->TransitionCount++] = (VkImageMemoryBarrier)
+	{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_GENERAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange =
+		{
+			.aspectMask = aspect,
+			.baseMipLevel = 0,
+			.levelCount = VK_REMAINING_MIP_LEVELS,
+			.baseArrayLayer = 0,
+			.layerCount = VK_REMAINING_ARRAY_LAYERS,
+		},
+	};
+	TransferTicket ticket = batch->Ticket;
+	SDL_UnlockMutex(Transfer.Mutex);
+	return ticket;
+}
+
+bool TransferIsComplete(TransferTicket ticket)
+{
+	SDL_LockMutex(Transfer.Mutex);
+	bool complete = ticket <= Transfer.AcquiredTicket;
+	SDL_UnlockMutex(Transfer.Mutex);
+	return complete;
+}
+
+static struct TransferUploadBatch * GetUploadBatch()
+{
+	if (Transfer.Uploading != NULL) { return Transfer.Uploading; }
+	
+	struct TransferUploadBatch * batch = NULL;
+	for (int i = 0; i < ListGetCount(Transfer.UploadBatches) && batch == NULL; i++)
+	{
+		struct TransferUploadBatch * candidate = ListGetValue(Transfer.UploadBatches, i);
+		if (candidate->Frame <= Graphics.CompletedFrame) { batch = candidate; }
+	}
+	if (batch == NULL)
+	{
+		batch = malloc(sizeof(struct TransferUploadBatch));
+		VkCommandBufferAllocateInfo commandAllocateInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandPool = Transfer.UploadPool,
+			.commandBufferCount = 1,
+		};
+		vkAllocateCommandBuffers(Graphics.Device, &commandAllocateInfo, &batch->CommandBuffer);
+		ListPush(Transfer.UploadBatches, batch);
+	}
+	else { vkResetCommandBuffer(batch->CommandBuffer, 0); }
+	
+	VkCommandBufferBeginInfo beginInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	};
+	vkBeginCommandBuffer(batch->CommandBuffer, &beginInfo);
+	// Frames that are still running could be reading the buffers that are about to be overwritten
+	VkPipelineStageFlags readStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+	vkCmdPipelineBarrier(batch->CommandBuffer, readStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 0, NULL);
+	batch->Frame = INT_MAX;
+	Transfer.UploadSequence++;
+	Transfer.Uploading = batch;
+	return batch;
+}
+
+void TransferUploadBuffer(VkBuffer buffer, TransferStaging staging, VkDeviceSize size, unsigned long long * uploadSequence)
+{
+	SDL_LockMutex(Transfer.Mutex);
+	struct TransferUploadBatch * batch = GetUploadBatch();
+	// Only copies into the same buffer need to be ordered, the rest can overlap
+	if (*uploadSequence == Transfer.UploadSequence)
+	{
+		VkMemoryBarrier barrier =
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		};
+		vkCmdPipelineBarrier(batch->CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+	}
+	VkBufferCopy copyInfo =
+	{
+		.srcOffset = staging.Offset,
+		.dstOffset = 0,
+		.size = size,
+	};
+	vkCmdCopyBuffer(batch->CommandBuffer, staging.Buffer, buffer, 1, &copyInfo);
+	*uploadSequence = Transfer.UploadSequence;
+	SDL_UnlockMutex(Transfer.Mutex);
+	TransferStagingRelease(staging);
+}
+
+VkCommandBuffer TransferEndUploads()
+{
+	SDL_LockMutex(Transfer.Mutex);
+	struct TransferUploadBatch * batch = Transfer.Uploading;
+	if (batch == NULL)
+	{
+		SDL_UnlockMutex(Transfer.Mutex);
+		return VK_NULL_HANDLE;
+	}
+	VkMemoryBarrier barrier =
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+	};
+	VkPipelineStageFlags readStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+	vkCmdPipelineBarrier(batch->CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, readStages, 0, 1, &barrier, 0, NULL, 0, NULL);
+	vkEndCommandBuffer(batch->CommandBuffer);
+	batch->Frame = SDL_AtomicGet(&Graphics.FrameNumber);
+	Transfer.Uploading = NULL;
+	SDL_UnlockMutex(Transfer.Mutex);
+	return batch->CommandBuffer;
+}
+
+// Each level is blitted from the one before it, then the whole chain is made ready for sampling
+static void GenerateMipmaps(VkCommandBuffer commandBuffer, TransferImage upload)
+{
+	VkImageMemoryBarrier barrier =
+	{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = upload.Image,
+		.subresourceRange =
+		{
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = upload.Layers,
+		},
+	};
+	for (unsigned int i = 1; i < upload.MipLevels; i++)
+	{
+		barrier.subresourceRange.baseMipLevel = i - 1;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+		VkImageBlit blit =
+		{
+			.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 0, upload.Layers },
+			.srcOffsets = { { 0, 0, 0 }, { MAX(upload.Width >> (i - 1), 1), MAX(upload.Height >> (i - 1), 1), 1 } },
+			.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, upload.Layers },
+			.dstOffsets = { { 0, 0, 0 }, { MAX(upload.Width >> i, 1), MAX(upload.Height >> i, 1), 1 } },
+		};
+		vkCmdBlitImage(commandBuffer, upload.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, upload.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+	}
+	
+	// Every level was a blit source except the last
+	VkImageMemoryBarrier barriers[2] = { barrier, barrier };
+	barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barriers[0].subresourceRange.baseMipLevel = 0;
+	barriers[0].subresourceRange.levelCount = upload.MipLevels - 1;
+	barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barriers[1].subresourceRange.baseMipLevel = upload.MipLevels - 1;
+	int barrierCount = upload.MipLevels > 1 ? 2 : 1;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, barrierCount, barriers + 2 - barrierCount);
+}
+
+// Records the acquires of every submitted batch up to a ticket, returns the number of batches
+static int RecordAcquires(VkCommandBuffer commandBuffer, TransferTicket ticket, VkSemaphore * semaphores, int acquireFrame)
+{
+	int count = 0;
+	for (int i = 0; i < ListGetCount(Transfer.Batches); i++)
+	{
+		struct TransferBatch * batch = ListGetValue(Transfer.Batches, i);
+		if (batch->State != TransferBatchStateSubmitted || batch->Ticket > ticket) { continue; }
+
+		VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		if (batch->AcquireCount > 0) { vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 0, NULL, 0, NULL, batch->AcquireCount, batch->Acquires); }
+		// The images could be used as attachments as well as sampled
+		if (batch->TransitionCount > 0) { vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, NULL, 0, NULL, batch->TransitionCount, batch->Transitions); }
+		for (int j = 0; j < batch->MipmapCount; j++) { GenerateMipmaps(commandBuffer, batch->Mipmaps[j]); }
+		semaphores[count++] = batch->Semaphore;
+		batch->State = TransferBatchStateAcquired;
+		batch->AcquireFrame = acquireFrame;
+		Transfer.AcquiredTicket = MAX(Transfer.AcquiredTicket, batch->Ticket);
+	}
+	return count;
+}
+
+static int CountSubmitted(TransferTicket ticket)
+{
+	int count = 0;
+	for (int i = 0; i < ListGetCount(Transfer.Batches); i++)
+	{
+		struct TransferBatch * batch = ListGetValue(Transfer.Batches, i);
+		if (batch->State == TransferBatchStateSubmitted && batch->Ticket <= ticket) { count++; }
+	}
+	return count;
+}
+
+void TransferWait(TransferTicket ticket)
+{
+	SDL_LockMutex(Transfer.Mutex);
+	if (ticket <= Transfer.AcquiredTicket)
+	{
+		SDL_UnlockMutex(Transfer.Mutex);
+		return;
+	}
+	if (Transfer.Recording != NULL && Transfer.Recording->Ticket <= ticket) { SubmitRecordingBatch(); }
+
+	// Nothing is being recorded on the graphics queue here, so the acquires go into their own submission
+	int count = CountSubmitted(ticket);
+	VkSemaphore * semaphores = malloc(count * sizeof(VkSemaphore));
+	VkPipelineStageFlags * waitStages = malloc(count * sizeof(VkPipelineStageFlags));
+	for (int i = 0; i < count; i++) { waitStages[i] = VK_PIPELINE_STAGE_TRANSFER_BIT; }
+
+	VkCommandBuffer commandBuffer;
+	VkCommandBufferAllocateInfo commandAllocateInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandPool = Graphics.CommandPool,
+		.commandBufferCount = 1,
+	};
+	vkAllocateCommandBuffers(Graphics.Device, &commandAllocateInfo, &commandBuffer);
+	VkCommandBufferBeginInfo beginInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	};
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	RecordAcquires(commandBuffer, ticket, semaphores, -1);
+	vkEndCommandBuffer(commandBuffer);
+
+	VkFence fence;
+	VkFenceCreateInfo fenceInfo = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	vkCreateFence(Graphics.Device, &fenceInfo, NULL, &fence);
+	VkSubmitInfo submitInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.waitSemaphoreCount = count,
+		.pWaitSemaphores = semaphores,
+		.pWaitDstStageMask = waitStages,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &commandBuffer,
+	};
+	vkQueueSubmit(Graphics.GraphicsQueue, 1, &submitInfo, fence);
+	SDL_AtomicAdd(&Graphics.Statistics.QueueSubmits, 1);
+	vkWaitForFences(Graphics.Device, 1, &fence, VK_TRUE, UINT64_MAX);
+	vkDestroyFence(Graphics.Device, fence, NULL);
+	vkFreeCommandBuffers(Graphics.Device, Graphics.CommandPool, 1, &commandBuffer);
+	free(waitStages);
+	free(semaphores);
+	SDL_UnlockMutex(Transfer.Mutex);
+}
+
+int TransferAcquire(int frameResource, VkSemaphore ** semaphores)
+{
+	SDL_LockMutex(Transfer.Mutex);
+	ReclaimBatches();
+	ReclaimStaging();
+	SubmitRecordingBatch();
+	int count = CountSubmitted(Transfer.NextTicket);
+	*semaphores = GraphicsFrameAllocate(frameResource, count * sizeof(VkSemaphore));
+	RecordAcquires(Graphics.FrameResources[frameResource].CommandBuffer, Transfer.NextTicket, *semaphores, SDL_AtomicGet(&Graphics.FrameNumber));
+	SDL_UnlockMutex(Transfer.Mutex);
+	return count;
+}
+
+void TransferDeinitialize()
+{
+	for (int i = 0; i < ListGetCount(Transfer.Batches); i++)
+	{
+		struct TransferBatch * batch = ListGetValue(Transfer.Batches, i);
+		free(batch->Acquires);
+		free(batch->Mipmaps);
+		free(batch->Transitions);
+		vkDestroySemaphore(Graphics.Device, batch->Semaphore, NULL);
+		vkDestroyFence(Graphics.Device, batch->Fence, NULL);
+		vkFreeCommandBuffers(Graphics.Device, Transfer.CommandPool, 1, &batch->CommandBuffer);
+		free(batch);
+	}
+	ListDestroy(Transfer.Batches);
+	for (int i = 0; i < ListGetCount(Transfer.UploadBatches); i++)
+	{
+		struct TransferUploadBatch * batch = ListGetValue(Transfer.UploadBatches, i);
+		vkFreeCommandBuffers(Graphics.Device, Transfer.UploadPool, 1, &batch->CommandBuffer);
+		free(batch);
+	}
+	ListDestroy(Transfer.UploadBatches);
+	vkDestroyCommandPool(Graphics.Device, Transfer.UploadPool, NULL);
+	
+	struct TransferStagingRing * ring = &Transfer.Staging;
+	for (unsigned long long i = ring->FirstEntry; i != ring->NextEntry; i++)
+	{
+		struct TransferStagingEntry * entry = ring->Entries + i % ring->EntryCapacity;
+		if (entry->DedicatedBuffer != VK_NULL_HANDLE) { vmaDestroyBuffer(Graphics.Allocator, entry->DedicatedBuffer, entry->DedicatedAllocation); }
+	}
+	for (int i = 0; i < ring->HeldCount; i++)
+	{
+		struct TransferStagingEntry * entry = ring->Held + i;
+		if (entry->DedicatedBuffer != VK_NULL_HANDLE) { vmaDestroyBuffer(Graphics.Allocator, entry->DedicatedBuffer, entry->DedicatedAllocation); }
+	}
+	free(ring->Held);
+	free(ring->Entries);
+	vmaDestroyBuffer(Graphics.Allocator, ring->Buffer, ring->Allocation);
+	vkDestroyCommandPool(Graphics.Device, Transfer.CommandPool, NULL);
+	SDL_DestroyMutex(Transfer.Mutex);
+}
@@ -0,0 +1,119 @@
+#ifndef Transfer_h
+#define Transfer_h
+
+#include <vulkan/vulkan.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Identifies a recorded upload, uploads complete in the order that they were recorded.
+/// 0 is always complete
+typedef unsigned long long TransferTicket;
+
+/// A region of upload memory that the gpu copies from
+typedef struct TransferStaging
+{
+	VkBuffer Buffer;
+	VkDeviceSize Offset;
+	/// Persistently mapped memory of the region
+	void * Data;
+	/// Identifies the region when it's released
+	unsigned long long Sequence;
+} TransferStaging;
+
+/// This should not be called by the user, it is called in the GraphicsInitialize function
+/// \param stagingRingSize The size in bytes of the staging ring, 0 defaults to 16MB
+void TransferInitialize(int stagingRingSize);
+
+/// Allocates upload memory from the staging ring, it falls back to a dedicated allocation if the upload doesn't fit.
+/// The region is reused after it's released and the frame recorded next has finished on the gpu.
+/// Regions are reclaimed in the order they were allocated. One that's still held when the regions before it are reclaimed is set aside,
+/// the ring skips over it until it's released, so holding regions for long leaves less of the ring for other uploads.
+/// This can be called from any thread. The user shouldn't need to call this
+/// \param size The size in bytes to allocate
+/// \return The region of staging memory
+TransferStaging TransferStagingAllocate(size_t size);
+
+/// Releases a region of staging memory once a copy from it has been submitted or recorded.
+/// This can be called from any thread. The user shouldn't need to call this
+/// \param staging The region to release
+void TransferStagingRelease(TransferStaging staging);
+
+/// An image and the pixels to upload into it
+typedef struct TransferImage
+{
+	/// The image to upload to, it must be in VK_IMAGE_LAYOUT_UNDEFINED
+	VkImage Image;
+	VkFormat Format;
+	unsigned int Width, Height;
+	unsigned int MipLevels;
+	/// The number of array layers, 0 is treated as 1
+	unsigned int Layers;
+	/// Whether the pixels only contain the first mip level and the rest are blitted from it on the graphics queue.
+	/// Otherwise the pixels contain every mip level one after another. The format must support linear blits to generate mipmaps.
+	/// Each layer's levels come before the next layer's
+	bool GenerateMipmaps;
+	/// The tightly packed pixels to copy
+	const void * Pixels;
+	/// The size of the pixels in bytes
+	size_t Size;
+} TransferImage;
+
+/// Gets the size of one tightly packed mip level, block-compressed formats are rounded up to whole 4x4 blocks.
+/// Every format other than BC1 to BC7 is assumed to be 4 bytes per a pixel
+/// \param format The format of the image
+/// \param width The width of the mip level
+/// \param height The height of the mip level
+/// \return The size in bytes
+size_t TransferGetLevelSize(VkFormat format, unsigned int width, unsigned int height);
+
+/// Records a copy of pixels into every mip level and layer of a color image on the transfer queue.
+/// The image is left in VK_IMAGE_LAYOUT_GENERAL and owned by the graphics queue once the upload is complete.
+/// The pixels are copied before returning. This can be called from any thread.
+/// The user shouldn't need to call this, use TextureCreateAsync instead
+/// \param upload The image and the pixels to upload
+/// \return The ticket of the upload
+TransferTicket TransferUploadImage(TransferImage upload);
+
+/// Moves an image without data out of VK_IMAGE_LAYOUT_UNDEFINED along with the next batch of image uploads.
+/// The image is in VK_IMAGE_LAYOUT_GENERAL once the upload is complete. This can be called from any thread.
+/// The user shouldn't need to call this, use TextureCreateAsync instead
+/// \param image The image, every mip level and layer is transitioned
+/// \param aspect The aspects of the image's format
+/// \return The ticket of the transition
+TransferTicket TransferTransitionImage(VkImage image, VkImageAspectFlags aspect);
+
+/// Records a copy from staging memory into a buffer, the copy is submitted right before the commands of the frame being recorded.
+/// The staging memory is released. This can be called from any thread.
+/// The user shouldn't need to call this, use the Upload function of the buffer instead
+/// \param buffer The buffer to copy to, starting at its beginning
+/// \param staging The staging memory to copy from
+/// \param size The size in bytes to copy
+/// \param uploadSequence Tracks the buffer's last upload so that copies into it are kept in order, 0 for a new buffer
+void TransferUploadBuffer(VkBuffer buffer, TransferStaging staging, VkDeviceSize size, unsigned long long * uploadSequence);
+
+/// Finishes recording the buffer uploads made since the last frame.
+/// This should not be called by the user, it is called in the GraphicsPresent function
+/// \return The command buffer to submit before the frame's commands, or VK_NULL_HANDLE if nothing was uploaded
+VkCommandBuffer TransferEndUploads(void);
+
+/// Checks without blocking if an upload can be used by frames that are recorded from now on
+/// \param ticket The ticket of the upload
+/// \return Whether or not the upload is complete
+bool TransferIsComplete(TransferTicket ticket);
+
+/// Blocks until an upload has finished on the gpu and is owned by the graphics queue.
+/// This must be called on the render thread
+/// \param ticket The ticket of the upload
+void TransferWait(TransferTicket ticket);
+
+/// Submits the recorded uploads and records their graphics queue acquires into the frame's command buffer.
+/// This should not be called by the user, it is called in the GraphicsAquireNextImage function
+/// \param frameResource The index of the frame resource being recorded
+/// \param semaphores Set to the semaphores the frame must wait on at the transfer stage, allocated from the frame arena
+/// \return The number of semaphores
+int TransferAcquire(int frameResource, VkSemaphore ** semaphores);
+
+/// This should not be called by the user, it is called in the GraphicsDeinitialize function
+void TransferDeinitialize(void);
+
+#endif
@@ -7,6 +7,7 @@ UniformBuffer UniformBufferCreate(Pipeline pipeline, int binding)
 {
 	UniformBuffer uniformBuffer = malloc(sizeof(struct UniformBuffer));
 	*uniformBuffer = (struct UniformBuffer){ 0 };
+	PipelineWait(pipeline);
 	
 	bool foundBinding = false;
 	for (int i = 0; i < pipeline->StageCount; i++)
@@ -25,45 +26,41 @@ UniformBuffer UniformBufferCreate(Pipeline pipeline, int binding)
 	if (!foundBinding) { abort(); }
 	
 	uniformBuffer->Size = uniformBuffer->Info.size;
-	VkBufferCreateInfo bufferInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		.size = uniformBuffer->Info.size,
-		.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-	};
-	VmaAllocationCreateInfo allocationInfo =
-	{
-		.usage = VMA_MEMORY_USAGE_CPU_ONLY,
-	};
-	VmaAllocationInfo info;
-	vmaCreateBuffer(Graphics.Allocator, &bufferInfo, &allocationInfo, &uniformBuffer->Buffer, &uniformBuffer->Allocation, &info);
+	uniformBuffer->Variables = ShaderVariableTableCreate(uniformBuffer->Info);
+	uniformBuffer->Data = calloc(1, uniformBuffer->Size);
+	// The first draw that uses the buffer uploads it
+	uniformBuffer->Version = 1;
+	uniformBuffer->UploadedFrame = -1;
+	uniformBuffer->OverflowFrame = -1;
 	
 	return uniformBuffer;
 }
 
 void UniformBufferSetVariable(UniformBuffer uniformBuffer, const char * variable, void * value)
 {
-	void * data;
-	vmaMapMemory(Graphics.Allocator, uniformBuffer->Allocation, &data);
-	for (int i = 0; i < uniformBuffer->Info.member_count; i++)
-	{
-		if (strcmp(uniformBuffer->Info.members[i].name, variable) == 0)
-		{
-			unsigned int offset = uniformBuffer->Info.members[i].offset;
-			unsigned int size = uniformBuffer->Info.members[i].size;
-			memcpy((unsigned char *)data + offset, value, size);
-		}
-	}
-	vmaUnmapMemory(Graphics.Allocator, uniformBuffer->Allocation);
+	UniformBufferSetVariableHandle(uniformBuffer, UniformBufferGetVariableHandle(uniformBuffer, variable), value);
+}
+
+ShaderVariable UniformBufferGetVariableHandle(UniformBuffer uniformBuffer, const char * variable)
+{
+	return ShaderVariableTableFind(uniformBuffer->Variables, variable);
+}
+
+void UniformBufferSetVariableHandle(UniformBuffer uniformBuffer, ShaderVariable variable, void * value)
+{
+	if (variable.Size == 0) { return; }
+	memcpy((unsigned char *)uniformBuffer->Data + variable.Offset, value, variable.Size);
+	uniformBuffer->Version++;
 }
 
 void UniformBufferQueueDestroy(UniformBuffer uniformBuffer)
 {
-	ListPush(Graphics.FrameResources[Graphics.FrameIndex].DestroyUniformBufferQueue, uniformBuffer);
+	GraphicsQueueDestroy(GraphicsDestroyTypeUniformBuffer, uniformBuffer);
 }
 
 void UniformBufferDestroy(UniformBuffer uniformBuffer)
 {
-	vmaDestroyBuffer(Graphics.Allocator, uniformBuffer->Buffer, uniformBuffer->Allocation);
+	free(uniformBuffer->Data);
+	ShaderVariableTableDestroy(uniformBuffer->Variables);
 	free(uniformBuffer);
 }
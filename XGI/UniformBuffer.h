@@ -5,31 +5,56 @@
 #include <vk_mem_alloc.h>
 #include "FrameBuffer.h"
 #include "LinearMath.h"
+#include "ShaderVariable.h"
 #include "Pipeline.h"
 
 struct Pipeline;
 
 typedef struct UniformBuffer
 {
-	VkBuffer Buffer;
-	VmaAllocation Allocation;
 	SpvReflectBlockVariable Info;
+	ShaderVariableTable Variables;
 	unsigned int Size;
+	/// The cpu copy of the uniform data, it's copied to the gpu by the draws that use it
+	void * Data;
+	unsigned int Version;
+	unsigned int UploadedVersion;
+	int UploadedFrame;
+	unsigned int UploadedOffset;
+	/// The same for the copy in the uniform ring's overflow block, which the frame uses once its ring is full
+	unsigned int OverflowVersion;
+	int OverflowFrame;
+	unsigned int OverflowOffset;
 } * UniformBuffer;
 
-/// Creates a memory buffer on the vram for use in shaders.
+/// Creates a uniform buffer for use in shaders.
+/// The data is kept on the cpu, every frame that uses the buffer gets its own copy on the gpu,
+/// so it can be changed between draw calls without affecting frames that are still rendering.
 /// The buffer can work for multiple pipelines and bindings, it just needs to view one for a template.
 /// \param pipeline The template pipeline used to determine variable locations
 /// \param binding The binding in the pipeline to make the template for.
 /// \return A buffer that can be used for multiple pipelines or shaders.
 UniformBuffer UniformBufferCreate(struct Pipeline * pipeline, int binding);
 
-/// Sets a member within the uniform binding struct
+/// Sets a member within the uniform binding struct.
+/// The new value is used by the draws made after this is called
 /// \param uniformBuffer The buffer to set
 /// \param variable The name of the member to set
 /// \param value A pointer to the memory to copy, it's assumed that it's allocated for the right size
 void UniformBufferSetVariable(UniformBuffer uniformBuffer, const char * variable, void * value);
 
+/// Looks up a member of the uniform binding struct so it can be set without searching by name every time
+/// \param uniformBuffer The buffer to look in
+/// \param variable The name of the member
+/// \return The handle to the member, it stays valid for the lifetime of the uniform buffer
+ShaderVariable UniformBufferGetVariableHandle(UniformBuffer uniformBuffer, const char * variable);
+
+/// Sets a member within the uniform binding struct using a handle from UniformBufferGetVariableHandle
+/// \param uniformBuffer The buffer to set
+/// \param variable The handle to the member
+/// \param value A pointer to the memory to copy, it's assumed that it's allocated for the right size
+void UniformBufferSetVariableHandle(UniformBuffer uniformBuffer, ShaderVariable variable, void * value);
+
 /// Places the uniform buffer into a queue to be destroyed.
 /// This should only be called if the uniform buffer needs to be destroyed at render-time
 /// \param uniformBuffer The uniform buffer to destroy
@@ -2,47 +2,77 @@
 #include <stdio.h>
 #include <vk_mem_alloc.h>
 #include "Graphics.h"
+#include "Transfer.h"
+#include "log.h"
 #include "VertexBuffer.h"
 
+static unsigned int AttributeSize(VertexAttribute attribute)
+{
+	switch (attribute)
+	{
+		case VertexAttributeVector4: return 16;
+		case VertexAttributeVector3: return 12;
+		case VertexAttributeVector2: return 8;
+		case VertexAttributeFloat: return 4;
+		case VertexAttributeByte4: return 4;
+	}
+	return 0;
+}
+
 VertexLayout VertexLayoutCreate(int attributeCount, VertexAttribute * attributes)
 {
+	VertexBindingConfigure binding =
+	{
+		.InputRate = VertexInputRateVertex,
+		.AttributeCount = attributeCount,
+		.Attributes = attributes,
+	};
+	return VertexLayoutCreateBindings(1, &binding);
+}
+
+VertexLayout VertexLayoutCreateBindings(int bindingCount, VertexBindingConfigure * bindings)
+{
+	int attributeCount = 0;
+	for (int i = 0; i < bindingCount; i++) { attributeCount += bindings[i].AttributeCount; }
+	
 	VertexLayout layout = malloc(sizeof(struct VertexLayout));
 	*layout = (struct VertexLayout)
 	{
+		.BindingCount = bindingCount,
+		.Bindings = malloc(bindingCount * sizeof(VkVertexInputBindingDescription)),
 		.AttributeCount = attributeCount,
 		.Attributes = malloc(attributeCount * sizeof(VkVertexInputAttributeDescription)),
 	};
-	int size = 0;
-	for (int i = 0; i < attributeCount; i++)
+	int location = 0;
+	for (int i = 0; i < bindingCount; i++)
 	{
-		layout->Attributes[i] = (VkVertexInputAttributeDescription)
+		int size = 0;
+		for (int j = 0; j < bindings[i].AttributeCount; j++)
 		{
-			.binding = 0,
-			.format = (VkFormat)attributes[i],
-			.location = i,
-			.offset = size,
-		};
-		switch (attributes[i])
-		{
-			case VertexAttributeVector4: size += 16; break;
-			case VertexAttributeVector3: size += 12; break;
-			case VertexAttributeVector2: size += 8; break;
-			case VertexAttributeFloat: size += 4; break;
-			case VertexAttributeByte4: size += 4; break;
+			layout->Attributes[location] = (VkVertexInputAttributeDescription)
+			{
+				.binding = i,
+				.format = (VkFormat)bindings[i].Attributes[j],
+				.location = location,
+				.offset = size,
+			};
+			size += AttributeSize(bindings[i].Attributes[j]);
+			location++;
 		}
+		layout->Bindings[i] = (VkVertexInputBindingDescription)
+		{
+			.binding = i,
+			.stride = size,
+			.inputRate = (VkVertexInputRate)bindings[i].InputRate,
+		};
 	}
-	layout->Binding = (VkVertexInputBindingDescription)
-	{
-		.binding = 0,
-		.stride = size,
-		.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-	};
-	layout->Size = size;
+	layout->Size = bindingCount > 0 ? layout->Bindings[0].stride : 0;
 	return layout;
 }
 
 void VertexLayoutDestroy(VertexLayout layout)
 {
+	free(layout->Bindings);
 	free(layout->Attributes);
 	free(layout);
 }
@@ -54,19 +84,6 @@ VertexBuffer VertexBufferCreate(int vertexCount, int vertexSize)
 	
 	size_t size = vertexCount * vertexSize;
 	
-	VkBufferCreateInfo stagingInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		.size = size,
-		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-	};
-	VmaAllocationCreateInfo stagingAllocationInfo =
-	{
-		.usage = VMA_MEMORY_USAGE_CPU_ONLY,
-	};
-	vmaCreateBuffer(Graphics.Allocator, &stagingInfo, &stagingAllocationInfo, &vertexBuffer->StagingBuffer, &vertexBuffer->StagingAllocation, NULL);
-	
 	VkBufferCreateInfo bufferInfo =
 	{
 		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -80,87 +97,44 @@ VertexBuffer VertexBufferCreate(int vertexCount, int vertexSize)
 	};
 	vmaCreateBuffer(Graphics.Allocator, &bufferInfo, &allocationInfo, &vertexBuffer->VertexBuffer, &vertexBuffer->VertexAllocation, NULL);
 	
-	VkCommandBufferAllocateInfo commandAllocateInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandPool = Graphics.CommandPool,
-		.commandBufferCount = 1,
-	};
-	vkAllocateCommandBuffers(Graphics.Device, &commandAllocateInfo, &vertexBuffer->CommandBuffer);
-	
-	VkFenceCreateInfo fenceInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-		.flags = VK_FENCE_CREATE_SIGNALED_BIT,
-	};
-	vkCreateFence(Graphics.Device, &fenceInfo, NULL, &vertexBuffer->Fence);
-	VkSemaphoreCreateInfo semaphoreInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-	};
-	vkCreateSemaphore(Graphics.Device, &semaphoreInfo, NULL, &vertexBuffer->Semaphore);
-	
 	return vertexBuffer;
 }
 
 void * VertexBufferMapVertices(VertexBuffer vertexBuffer)
 {
-	void * data;
-	vmaMapMemory(Graphics.Allocator, vertexBuffer->StagingAllocation, &data);
-	return data;
+	// The staging memory is only held from mapping until the upload is recorded
+	if (!vertexBuffer->Mapped)
+	{
+		vertexBuffer->Staging = TransferStagingAllocate(vertexBuffer->VertexCount * vertexBuffer->VertexSize);
+		vertexBuffer->Mapped = true;
+	}
+	return vertexBuffer->Staging.Data;
 }
 
 void VertexBufferUnmapVertices(VertexBuffer vertexBuffer)
 {
-	vmaUnmapMemory(Graphics.Allocator, vertexBuffer->StagingAllocation);
+	// The staging ring is persistently mapped, the region is released once the upload is recorded
 }
 
 void VertexBufferUpload(VertexBuffer vertexBuffer)
 {
-	vkWaitForFences(Graphics.Device, 1, &vertexBuffer->Fence, VK_TRUE, UINT64_MAX);
-	vkResetFences(Graphics.Device, 1, &vertexBuffer->Fence);
-	
-	VkCommandBufferBeginInfo beginInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-	};
-	
-	vkBeginCommandBuffer(vertexBuffer->CommandBuffer, &beginInfo);
-	VkBufferCopy copyInfo =
+	if (!vertexBuffer->Mapped)
 	{
-		.srcOffset = 0,
-		.dstOffset = 0,
-		.size = vertexBuffer->VertexCount * vertexBuffer->VertexSize,
-	};
-	vkCmdCopyBuffer(vertexBuffer->CommandBuffer, vertexBuffer->StagingBuffer, vertexBuffer->VertexBuffer, 1, &copyInfo);
-	vkEndCommandBuffer(vertexBuffer->CommandBuffer);
-	
-	VkSubmitInfo submitInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &vertexBuffer->CommandBuffer,
-		.signalSemaphoreCount = 1,
-		.pSignalSemaphores = &vertexBuffer->Semaphore,
-	};
-	vkQueueSubmit(Graphics.GraphicsQueue, 1, &submitInfo, vertexBuffer->Fence);
-	ListPush(Graphics.PreRenderSemaphores, &vertexBuffer->Semaphore);
+		log_warn("VertexBuffer was uploaded without being mapped, there is nothing to upload\n");
+		return;
+	}
+	TransferUploadBuffer(vertexBuffer->VertexBuffer, vertexBuffer->Staging, vertexBuffer->VertexCount * vertexBuffer->VertexSize, &vertexBuffer->UploadSequence);
+	vertexBuffer->Mapped = false;
 }
 
 void VertexBufferQueueDestroy(VertexBuffer vertexBuffer)
 {
-	ListPush(Graphics.FrameResources[Graphics.FrameIndex].DestroyVertexBufferQueue, vertexBuffer);
+	GraphicsQueueDestroy(GraphicsDestroyTypeVertexBuffer, vertexBuffer);
 }
 
 void VertexBufferDestroy(VertexBuffer vertexBuffer)
 {
-	vkWaitForFences(Graphics.Device, 1, &vertexBuffer->Fence, VK_TRUE, UINT64_MAX);
-	vkDestroyFence(Graphics.Device, vertexBuffer->Fence, NULL);
-	vkDestroySemaphore(Graphics.Device, vertexBuffer->Semaphore, NULL);
-	vkFreeCommandBuffers(Graphics.Device, Graphics.CommandPool, 1, &vertexBuffer->CommandBuffer);
-	vmaDestroyBuffer(Graphics.Allocator, vertexBuffer->StagingBuffer, vertexBuffer->StagingAllocation);
+	if (vertexBuffer->Mapped) { TransferStagingRelease(vertexBuffer->Staging); }
 	vmaDestroyBuffer(Graphics.Allocator, vertexBuffer->VertexBuffer, vertexBuffer->VertexAllocation);
 	free(vertexBuffer);
 }
@@ -3,6 +3,7 @@
 
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
+#include "Transfer.h"
 #include "LinearMath.h"
 
 typedef enum VertexAttribute
@@ -19,20 +20,47 @@ typedef enum VertexAttribute
 	VertexAttributeFloat = VK_FORMAT_R32_SFLOAT,
 } VertexAttribute;
 
+typedef enum VertexInputRate
+{
+	/// The binding advances once per a vertex
+	VertexInputRateVertex = VK_VERTEX_INPUT_RATE_VERTEX,
+	/// The binding advances once per an instance
+	VertexInputRateInstance = VK_VERTEX_INPUT_RATE_INSTANCE,
+} VertexInputRate;
+
+typedef struct VertexBindingConfigure
+{
+	/// Whether the binding's data is per-vertex or per-instance
+	VertexInputRate InputRate;
+	/// The number of attributes in the binding
+	int AttributeCount;
+	/// An array of attributes, their shader locations continue on from the previous binding
+	VertexAttribute * Attributes;
+} VertexBindingConfigure;
+
 typedef struct VertexLayout
 {
-	VkVertexInputBindingDescription Binding;
+	unsigned int BindingCount;
+	VkVertexInputBindingDescription * Bindings;
 	unsigned int AttributeCount;
 	VkVertexInputAttributeDescription * Attributes;
+	/// The size of a vertex in the first binding
 	unsigned int Size;
 } * VertexLayout;
 
-/// Creates a vertex layout object used for pipelines
+/// Creates a vertex layout object used for pipelines, with a single per-vertex binding
 /// \param attributeCount The number of attributes in the layout
 /// \param attributes An array of attributes
 /// \return The created vertex layout object
 VertexLayout VertexLayoutCreate(int attributeCount, VertexAttribute * attributes);
 
+/// Creates a vertex layout object with several bindings, each one is read from a separate vertex buffer.
+/// Binding 0 is usually the per-vertex mesh and binding 1 the per-instance data for GraphicsRenderInstanced
+/// \param bindingCount The number of bindings in the layout
+/// \param bindings An array of binding configurations
+/// \return The created vertex layout object
+VertexLayout VertexLayoutCreateBindings(int bindingCount, VertexBindingConfigure * bindings);
+
 /// Destroys a vertex layout object
 /// \param layout The vertex layout to destroy
 void VertexLayoutDestroy(VertexLayout layout);
@@ -41,13 +69,11 @@ typedef struct VertexBuffer
 {
 	int VertexCount;
 	int VertexSize;
-	VkBuffer StagingBuffer;
-	VmaAllocation StagingAllocation;
+	TransferStaging Staging;
+	bool Mapped;
 	VkBuffer VertexBuffer;
 	VmaAllocation VertexAllocation;
-	VkCommandBuffer CommandBuffer;
-	VkFence Fence;
-	VkSemaphore Semaphore;
+	unsigned long long UploadSequence;
 } * VertexBuffer;
 
 /// Creates a vertex buffer used for rendering
@@ -58,6 +84,8 @@ VertexBuffer VertexBufferCreate(int vertexCount, int vertexSize);
 
 /// Allows for copying data into a vertex buffer.
 /// This function only stages the memory onto the cpu, call VertexBufferUpload for it to be visible on the gpu.
+/// The memory comes from the staging ring and isn't kept after uploading, so every vertex must be written each time.
+/// The staging memory is held until the upload, so a buffer shouldn't stay mapped for longer than a frame or two.
 /// \param vertexBuffer The vertexbuffer to copy data to
 /// \return A pointer to memory that is pre-allocated to vertexCount * vertexSize
 void * VertexBufferMapVertices(VertexBuffer vertexBuffer);
@@ -68,6 +96,7 @@ void * VertexBufferMapVertices(VertexBuffer vertexBuffer);
 void VertexBufferUnmapVertices(VertexBuffer vertexBuffer);
 
 /// Pushes the memory staged in VertexBufferMapVertices to the GPU for use in shaders.
+/// The copy is recorded with every other upload of the frame and submitted right before the frame's commands.
 /// If this isn't called then the gpu will render garbage data.
 /// \param vertexBuffer The vertexbuffer to upload
 void VertexBufferUpload(VertexBuffer vertexBuffer);
@@ -35,6 +35,16 @@ void WindowInitialize(WindowConfigure flags)
 	log_info("Successfully initialized the window.\n");
 }
 
+void WindowInitializeHeadless(WindowConfigure flags)
+{
+	log_info("Initializing without a window...\n");
+	Window.Title = flags.Title;
+	Window.Width = flags.Width;
+	Window.Height = flags.Height;
+	Window.Running = true;
+	Window.Handle = NULL;
+}
+
 bool WindowRunning() { return Window.Running; }
 
 void WindowExitLoop()
@@ -82,7 +92,10 @@ float WindowBrightness() { return SDL_GetWindowBrightness(Window.Handle); }
 
 int WindowDisplayIndex() { return SDL_GetWindowDisplayIndex(Window.Handle); }
 
-void WindowDeinitialize() { SDL_DestroyWindow(Window.Handle); }
+void WindowDeinitialize()
+{
+	if (Window.Handle != NULL) { SDL_DestroyWindow(Window.Handle); }
+}
 
 Vector2 WindowMaximumSize()
 {
@@ -52,6 +52,10 @@ struct Window
 /// This should not be called, it's automatically called in XGIInitialize
 void WindowInitialize(WindowConfigure flags);
 
+/// This should not be called, it's automatically called in XGIInitialize when graphics is headless.
+/// The window state is set up without creating an SDL window, the width and height are used as the render size
+void WindowInitializeHeadless(WindowConfigure flags);
+
 /// Use as the exit condition for the main loop, it's initialized as true
 bool WindowRunning(void);
 
@@ -5,12 +5,16 @@
 void XGIInitialize(WindowConfigure windowFlags, GraphicsConfigure graphicsFlags)
 {
 	log_info("Initializing XGI...\n");
-	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_JOYSTICK) < 0)
+	InstrumentInitialize();
+	unsigned int subsystems = graphicsFlags.Headless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_JOYSTICK;
+	if (SDL_Init(subsystems) < 0)
 	{
 		log_fatal("Failed to initialize SDL\n");
 		exit(1);
 	}
-	WindowInitialize(windowFlags);
+	if (graphicsFlags.Headless) { WindowInitializeHeadless(windowFlags); }
+	else { WindowInitialize(windowFlags); }
+	JobSystemInitialize(graphicsFlags.WorkerThreadCount);
 	GraphicsInitialize(graphicsFlags);
 	EventHandlerInitialize();
 	log_info("Successfully initialized XGI.\n");
@@ -19,6 +23,8 @@ void XGIInitialize(WindowConfigure windowFlags, GraphicsConfigure graphicsFlags)
 void XGIDeinitialize()
 {
 	EventHandlerDeinitialize();
+	JobSystemDeinitialize();
 	GraphicsDeinitialize();
 	WindowDeinitialize();
+	InstrumentDeinitialize();
 }
@@ -1,15 +1,22 @@
 #ifndef XGI_h
 #define XGI_h
 
+#include "Bindless.h"
 #include "EventHandler.h"
 #include "File.h"
 #include "FrameBuffer.h"
 #include "Graphics.h"
+#include "IndexBuffer.h"
+#include "IndirectBuffer.h"
+#include "Instrument.h"
+#include "Job.h"
 #include "LinearMath.h"
 #include "List.h"
 #include "Pipeline.h"
 #include "Random.h"
+#include "RenderQueue.h"
 #include "Texture.h"
+#include "Transfer.h"
 #include "UniformBuffer.h"
 #include "VertexBuffer.h"
 #include "Window.h"